@@ -25,7 +25,9 @@
 
 #include "CICalendarComponentExpanded.h"
 #include "CICalendarDefinitions.h"
+#include "CICalendarOutputBuffer.h"
 #include "CICalendarTextValue.h"
+#include "CICalendarTimezoneTable.h"
 #include "CICalendarVAlarm.h"
 #include "CICalendarVEvent.h"
 #include "CICalendarVFreeBusy.h"
@@ -52,20 +54,38 @@ CICalendar::CICalendarRefMap CICalendar::sICalendars;
 CICalendarRef CICalendar::sICalendarRefCtr = 1;
 #endif
 
+// Function static so that this is available during static initialisation
+static CICalendarMutex& GetRegistryMutex()
+{
+	static CICalendarMutex sMutex;
+	return sMutex;
+}
+
 CICalendar&
 CICalendar::getSICalendar()
 {
 	static CICalendar *sICalendar = NULL;
-	if (sICalendar == NULL)
+	static CICalendar *sInitialising = NULL;
+	if (CICalendarMutex::LoadAcquire(sICalendar) == NULL)
 	{
-		sICalendar = new CICalendar();
-		sICalendar->InitDefaultTimezones();
+		CICalendarMutex::StLock lock(GetRegistryMutex());
+		if (sICalendar == NULL)
+		{
+			// Loading the default timezones comes back here on the same thread
+			if (sInitialising != NULL)
+				return *sInitialising;
+
+			sInitialising = new CICalendar();
+			sInitialising->InitDefaultTimezones();
+			CICalendarMutex::StoreRelease(sICalendar, sInitialising);
+		}
 	}
 	return *sICalendar;
 }
 
 CICalendar* CICalendar::GetICalendar(const CICalendarRef& ref)
 {
+	CICalendarMutex::StLock lock(GetRegistryMutex());
 	CICalendarRefMap::iterator found = sICalendars.find(ref);
 	if (found != sICalendars.end())
 		return (*found).second;
@@ -78,12 +98,28 @@ CICalendar::CComponentRegisterMap CICalendar::sEmbeddedComponents;
 
 CICalendar::CICalendar()
 {
-	mICalendarRef = sICalendarRefCtr++;
-	sICalendars.insert(CICalendarRefMap::value_type(mICalendarRef, this));
+	{
+		CICalendarMutex::StLock lock(GetRegistryMutex());
+		mICalendarRef = sICalendarRefCtr++;
+		sICalendars.insert(CICalendarRefMap::value_type(mICalendarRef, this));
+	}
 
 	mReadOnly = false;
 	mDirty = false;
 
+	mTimezoneTable = NULL;
+	mArena = NULL;
+	mLazyValues = false;
+
+	// Each DB keeps the calendar-wide key index up to date
+	mVEvent.SetKeyIndex(&mKeyIndex);
+	mVToDo.SetKeyIndex(&mKeyIndex);
+	mVJournal.SetKeyIndex(&mKeyIndex);
+	mVFreeBusy.SetKeyIndex(&mKeyIndex);
+	mVTimezone.SetKeyIndex(&mKeyIndex);
+	mVEvent.SetIntervalIndex(&mVEventIntervals);
+	mVEvent.SetInstanceCache(&mVEventInstances);
+
 	AddDefaultProperties();
 
 	// Special init for static item
@@ -105,6 +141,11 @@ CICalendar::~CICalendar()
 	mVFreeBusy.RemoveAllComponents();
 	mVTimezone.RemoveAllComponents();
 
+	// Anything still using the arena keeps it alive
+	if (mArena != NULL)
+		mArena->Release();
+
+	CICalendarMutex::StLock lock(GetRegistryMutex());
 	sICalendars.erase(mICalendarRef);
 }
 
@@ -151,6 +192,27 @@ void CICalendar::Clear()
 	mVJournal.RemoveAllComponents();
 	mVFreeBusy.RemoveAllComponents();
 	mVTimezone.RemoveAllComponents();
+	mKeyIndex.clear();
+	mVEventIntervals.clear();
+	mVEventInstances.clear();
+
+	// Free old parsed data in one go and start a new arena
+	if (mArena != NULL)
+	{
+		mArena->Release();
+		mArena = new CICalendarArena;
+	}
+}
+
+void CICalendar::SetUseArena(bool use_arena)
+{
+	if (use_arena && (mArena == NULL))
+		mArena = new CICalendarArena;
+	else if (!use_arena && (mArena != NULL))
+	{
+		mArena->Release();
+		mArena = NULL;
+	}
 }
 
 CICalendarComponentDB& CICalendar::GetComponents(CICalendarComponent::EComponentType type)
@@ -250,142 +312,171 @@ bool CICalendar::Parse(std::istream& is)
 	// Always init rhe component maps
 	InitComponents();
 
-	bool result = false;
+	CICalendarArena::StUseArena use_arena(mArena);
 
-	enum EParserState
-	{
-		eLookForVCalendar,
-		eGetPropertyOrComponent,
-		eGetComponentProperty,
-		eGetSubComponentProperty
-	};
-
-	EParserState state = eLookForVCalendar;
+	SParseState state;
 
 	// Get lines looking for start of calendar
 	cdstring line1;
 	cdstring line2;
-	CICalendarComponent* comp = NULL;
-	CICalendarComponent* prevcomp = NULL;
-	CICalendarComponentDB* compmap = NULL;
 
 	while(!is.fail() && CICalendarUtils::ReadFoldedLine(is, line1, line2))
 	{
-		switch(state)
+		if (!ParseLine(line1, state))
+			return false;
+	}
+
+	ParseDone();
+
+	return state.mResult;
+}
+
+// Parse directly from a contiguous buffer - avoids the stream and per-line allocation overhead
+bool CICalendar::Parse(const char* data, size_t length)
+{
+	// Always init rhe component maps
+	InitComponents();
+
+	CICalendarArena::StUseArena use_arena(mArena);
+
+	SParseState state;
+
+	// Single line buffer is re-used for each unfolded line
+	cdstring line;
+	const char* p = data;
+	const char* end = data + length;
+
+	while(CICalendarUtils::ReadFoldedLine(p, end, line))
+	{
+		if (!ParseLine(line, state))
+			return false;
+	}
+
+	ParseDone();
+
+	return state.mResult;
+}
+
+// Process one unfolded line - returns false if parsing must stop
+bool CICalendar::ParseLine(cdstring& line, SParseState& state)
+{
+	switch(state.mState)
+	{
+	case eLookForVCalendar:
+		// Look for start
+		if (line.compare(cICalComponent_BEGINVCALENDAR) == 0)
 		{
-		case eLookForVCalendar:
-			// Look for start
-			if (line1.compare(cICalComponent_BEGINVCALENDAR) == 0)
-			{
-				// Next state
-				state = eGetPropertyOrComponent;
+			// Next state
+			state.mState = eGetPropertyOrComponent;
 
-				// Indicate success at this point
-				result = true;
-			}
-			break;
-		case eGetPropertyOrComponent:
+			// Indicate success at this point
+			state.mResult = true;
+		}
+		break;
+	case eGetPropertyOrComponent:
+	{
+		// Parse property or look for start of component
+		CComponentRegisterMap::const_iterator found = sComponents.find(line);
+		if (found != sComponents.end())
 		{
-			// Parse property or look for start of component
-			CComponentRegisterMap::const_iterator found = sComponents.find(line1);
-			if (found != sComponents.end())
-			{
-				// Start a new component
-				comp = (*found).second->mCreatePP(GetRef());
+			// Start a new component
+			state.mComp = (*found).second->mCreatePP(GetRef());
 
-				// Set the marker for the end of this component and the map to store it in
-				compmap = &GetComponents((*found).second->mType);
+			// Set the marker for the end of this component and the map to store it in
+			state.mCompMap = &GetComponents((*found).second->mType);
 
-				// Change state
-				state = eGetComponentProperty;
-			}
-			else if (line1.compare(cICalComponent_ENDVCALENDAR) == 0)
+			// Change state
+			state.mState = eGetComponentProperty;
+		}
+		else if (line.compare(cICalComponent_ENDVCALENDAR) == 0)
+		{
+			// Finalise the current calendar
+			Finalise();
+
+			// Change state
+			state.mState = eLookForVCalendar;
+		}
+		else
+		{
+			// Parse attribute/value for top-level calendar item
+			CICalendarProperty prop;
+			if (prop.Parse(line, mLazyValues))
 			{
-				// Finalise the current calendar
-				Finalise();
+				// Check for valid property
+				if (!ValidProperty(prop))
+					return false;
+				else if (!IgnoreProperty(prop))
+					AddProperty(prop);
+			}
+		}
+		break;
+	}
+	case eGetComponentProperty:
+	case eGetSubComponentProperty:
+		// Look for end of current component
+		if (line.compare(state.mComp->GetEndDelimiter()) == 0)
+		{
+			// Finalise the component (this caches data from the properties)
+			state.mComp->Finalise();
 
-				// Change state
-				state = eLookForVCalendar;
+			// Check whether this is embedded
+			if (state.mPrevComp != NULL)
+			{
+				// Embed component in parent and reset to use parent
+				if (!state.mPrevComp->AddComponent(state.mComp))
+					delete state.mComp;
+				state.mComp = state.mPrevComp;
+				state.mPrevComp = NULL;
+
+				// Reset state
+				state.mState = eGetComponentProperty;
 			}
 			else
 			{
-				// Parse attribute/value for top-level calendar item
-				CICalendarProperty prop;
-				if (prop.Parse(line1))
-				{
-					// Check for valid property
-					if (!ValidProperty(prop))
-						return false;
-					else if (!IgnoreProperty(prop))
-						AddProperty(prop);
-				}
+				// Check for valid component
+				if (!state.mCompMap->AddComponent(state.mComp))
+					delete state.mComp;
+				state.mComp = NULL;
+				state.mCompMap = NULL;
+
+				// Reset state
+				state.mState = eGetPropertyOrComponent;
 			}
-			break;
 		}
-		case eGetComponentProperty:
-		case eGetSubComponentProperty:
-			// Look for end of current component
-			if (line1.compare(comp->GetEndDelimiter()) == 0)
+		else
+		{
+			// Look for start of embedded component (can only do once)
+			CComponentRegisterMap::const_iterator found = sEmbeddedComponents.find(line);
+			if ((state.mState != eGetSubComponentProperty) && (found != sEmbeddedComponents.end()))
 			{
-				// Finalise the component (this caches data from the properties)
-				comp->Finalise();
-
-				// Check whether this is embedded
-				if (prevcomp != NULL)
-				{
-					// Embed component in parent and reset to use parent
-					if (!prevcomp->AddComponent(comp))
-						delete comp;
-					comp = prevcomp;
-					prevcomp = NULL;
+				// Start a new component (saving off the current one)
+				state.mPrevComp = state.mComp;
+				state.mComp = (*found).second->mCreatePP(GetRef());
 
-					// Reset state
-					state = eGetComponentProperty;
-				}
-				else
-				{
-					// Check for valid component
-					if (!compmap->AddComponent(comp))
-						delete comp;
-					comp = NULL;
-					compmap = NULL;
-
-					// Reset state
-					state = eGetPropertyOrComponent;
-				}
+				// Reset state
+				state.mState = eGetSubComponentProperty;
 			}
 			else
 			{
-				// Look for start of embedded component (can only do once)
-				CComponentRegisterMap::const_iterator found = sEmbeddedComponents.find(line1);
-				if ((state != eGetSubComponentProperty) && (found != sEmbeddedComponents.end()))
-				{
-					// Start a new component (saving off the current one)
-					prevcomp = comp;
-					comp = (*found).second->mCreatePP(GetRef());
-
-					// Reset state
-					state = eGetSubComponentProperty;
-				}
-				else
-				{
-					// Parse attribute/value and store in component
-					CICalendarProperty prop;
-					if (prop.Parse(line1))
-						comp->AddProperty(prop);
-				}
+				// Parse attribute/value and store in component
+				CICalendarProperty prop;
+				if (prop.Parse(line, mLazyValues))
+					state.mComp->AddProperty(prop);
 			}
-			break;
 		}
+		break;
 	}
 
+	return true;
+}
+
+void CICalendar::ParseDone()
+{
 	// We need to store all timezones in the static object so they can be accessed by any date object
 	if (this != &getSICalendar())
 	{
 		getSICalendar().MergeTimezones(*this);
 	}
-
-	return result;
 }
 
 iCal::CICalendarComponent* CICalendar::ParseComponent(std::istream& is, const cdstring& rurl, const cdstring& etag)
@@ -415,6 +506,8 @@ iCal::CICalendarComponent* CICalendar::ParseComponent(std::istream& is, const cd
 	std::auto_ptr<CICalendarProperty> method;
 	bool got_timezone = false;
 
+	CICalendarArena::StUseArena use_arena(mArena);
+
 	while(!is.fail() && CICalendarUtils::ReadFoldedLine(is, line1, line2))
 	{
 		switch(state)
@@ -466,7 +559,7 @@ iCal::CICalendarComponent* CICalendar::ParseComponent(std::istream& is, const cd
 
 				// Parse attribute/value for top-level calendar item
 				std::auto_ptr<CICalendarProperty> prop(new CICalendarProperty);
-				if (prop->Parse(line1))
+				if (prop->Parse(line1, mLazyValues))
 				{
 					// Check for METHOD
 					if (prop->GetName() == cICalProperty_METHOD)
@@ -534,7 +627,7 @@ iCal::CICalendarComponent* CICalendar::ParseComponent(std::istream& is, const cd
 				{
 					// Parse attribute/value and store in component
 					CICalendarProperty prop;
-					if (prop.Parse(line1))
+					if (prop.Parse(line1, mLazyValues))
 						comp->AddProperty(prop);
 				}
 			}
@@ -584,6 +677,16 @@ bool CICalendar::IgnoreProperty(const CICalendarProperty& prop) const
 
 void CICalendar::Generate(std::ostream& os, bool for_cache) const
 {
+	// Write everything via one reusable buffer
+	if (dynamic_cast<CICalendarOutputBuffer*>(os.rdbuf()) == NULL)
+	{
+		CICalendarOutputBuffer buffer(os);
+		std::ostream bos(&buffer);
+		Generate(bos, for_cache);
+		buffer.Flush();
+		return;
+	}
+
 	// Make sure all required timezones are in this object
 	const_cast<CICalendar*>(this)->IncludeTimezones();
 
@@ -607,6 +710,16 @@ void CICalendar::Generate(std::ostream& os, bool for_cache) const
 
 void CICalendar::GenerateOne(std::ostream& os, const CICalendarComponent& comp) const
 {
+	// Write everything via one reusable buffer
+	if (dynamic_cast<CICalendarOutputBuffer*>(os.rdbuf()) == NULL)
+	{
+		CICalendarOutputBuffer buffer(os);
+		std::ostream bos(&buffer);
+		GenerateOne(bos, comp);
+		buffer.Flush();
+		return;
+	}
+
 	// Write header
 	os << cICalComponent_BEGINVCALENDAR << net_endl;
 
@@ -671,16 +784,51 @@ bool CICalendar::HasData() const
 
 // Get components based on requirements
 
+static bool sort_by_mapkey(CICalendarComponentRecur* e1, CICalendarComponentRecur* e2)
+{
+	return e1->GetMapKey() < e2->GetMapKey();
+}
+
+// Shared items for each instance
 void CICalendar::GetVEvents(const CICalendarPeriod& period, CICalendarExpandedComponents& list, bool all_day_at_top) const
 {
-	// Look at each VEvent
-	for(CICalendarComponentDB::const_iterator iter = mVEvent.begin(); iter != mVEvent.end(); iter++)
+	CICalendarInstanceList instances;
+	GetVEvents(period, instances, all_day_at_top);
+
+	list.reserve(list.size() + instances.size());
+	for(CICalendarInstanceList::const_iterator iter = instances.begin(); iter != instances.end(); iter++)
+		list.push_back(CICalendarComponentExpandedShared(new CICalendarComponentExpanded(*iter)));
+}
+
+void CICalendar::GetVEvents(const CICalendarPeriod& period, CICalendarInstanceList& list, bool all_day_at_top) const
+{
+	// Index is built on first use
 	{
-		CICalendarVEvent* vevent = static_cast<CICalendarVEvent*>((*iter).second);
-		vevent->ExpandPeriod(period, list);
+		CICalendarMutex::StLock lock(mCacheMutex);
+		if (!mVEventIntervals.IsBuilt())
+			const_cast<CICalendar*>(this)->mVEventIntervals.Build(mVEvent);
+	}
+
+	// Only look at VEvents that might be in the period
+	CICalendarComponentRecurs candidates;
+	mVEventIntervals.Find(period, candidates);
+
+	// Same order as the DB so that equal start times sort the same way
+	std::sort(candidates.begin(), candidates.end(), sort_by_mapkey);
+	for(CICalendarComponentRecurs::const_iterator iter = candidates.begin(); iter != candidates.end(); iter++)
+	{
+		// Recurring ones come from the cache
+		CICalendarVEvent* vevent = static_cast<CICalendarVEvent*>(*iter);
+		if (CICalendarInstanceCache::CanCache(vevent))
+		{
+			CICalendarMutex::StLock lock(mCacheMutex);
+			const_cast<CICalendar*>(this)->mVEventInstances.ExpandPeriod(vevent, period, list);
+		}
+		else
+			vevent->ExpandPeriod(period, list);
 	}
 	
-	std::sort(list.begin(), list.end(), all_day_at_top ? CICalendarComponentExpanded::sort_by_dtstart_allday : CICalendarComponentExpanded::sort_by_dtstart);
+	std::sort(list.begin(), list.end(), all_day_at_top ? CICalendarInstance::sort_by_dtstart_allday : CICalendarInstance::sort_by_dtstart);
 }
 
 void CICalendar::GetVToDos(bool only_due, bool all_dates, const CICalendarDateTime& upto_due_date, CICalendarExpandedComponents& list) const
@@ -750,7 +898,7 @@ void CICalendar::GetVFreeBusy(const CICalendarPeriod& period, CICalendarComponen
 void CICalendar::GetVFreeBusy(const CICalendarPeriod& period, CICalendarComponent& fb) const
 {
 	// First create expanded set
-	CICalendarExpandedComponents list;
+	CICalendarInstanceList list;
 	GetVEvents(period, list);
 	if (list.size() == 0)
 		return;
@@ -758,20 +906,20 @@ void CICalendar::GetVFreeBusy(const CICalendarPeriod& period, CICalendarComponen
 	// Get start/end list for each non-all-day expanded components
 	CICalendarDateTimeList dtstart;
 	CICalendarDateTimeList dtend;
-	for(CICalendarExpandedComponents::const_iterator iter = list.begin(); iter != list.end(); iter++)
+	for(CICalendarInstanceList::const_iterator iter = list.begin(); iter != list.end(); iter++)
 	{
 		// Ignore if all-day
-		if ((*iter)->GetInstanceStart().IsDateOnly())
+		if ((*iter).IsDateOnly())
 			continue;
 		
 		// Ignore if transparent to free-busy
 		cdstring transp;
-		if ((*iter)->GetOwner()->GetProperty(cICalProperty_TRANSP, transp) && (transp == cICalProperty_TRANSPARENT))
+		if ((*iter).GetOwner()->GetProperty(cICalProperty_TRANSP, transp) && (transp == cICalProperty_TRANSPARENT))
 			continue;
 		
 		// Add start/end to list
-		dtstart.push_back((*iter)->GetInstanceStart());
-		dtend.push_back((*iter)->GetInstanceEnd());
+		dtstart.push_back((*iter).GetInstanceStart());
+		dtend.push_back((*iter).GetInstanceEnd());
 	}
 	
 	// No longer need the expanded items
@@ -810,30 +958,30 @@ void CICalendar::GetFreeBusy(const CICalendarPeriod& period, CICalendarFreeBusyL
 {
 	// First create expanded set
 	{
-		CICalendarExpandedComponents list;
+		CICalendarInstanceList list;
 		GetVEvents(period, list);
 		
 		// Get start/end list for each non-all-day expanded components
-		for(CICalendarExpandedComponents::const_iterator iter = list.begin(); iter != list.end(); iter++)
+		for(CICalendarInstanceList::const_iterator iter = list.begin(); iter != list.end(); iter++)
 		{
 			// Ignore if all-day
-			if ((*iter)->GetInstanceStart().IsDateOnly())
+			if ((*iter).IsDateOnly())
 				continue;
 			
 			// Ignore if transparent to free-busy
 			cdstring transp;
-			if ((*iter)->GetOwner()->GetProperty(cICalProperty_TRANSP, transp) && (transp == cICalProperty_TRANSPARENT))
+			if ((*iter).GetOwner()->GetProperty(cICalProperty_TRANSP, transp) && (transp == cICalProperty_TRANSPARENT))
 				continue;
 			
 			// Add free busy item to list
-			switch((*iter)->GetMaster<CICalendarVEvent>()->GetStatus())
+			switch((*iter).GetMaster<CICalendarVEvent>()->GetStatus())
 			{
 			case eStatus_VEvent_None:
 			case eStatus_VEvent_Confirmed:
-				fb.push_back(CICalendarFreeBusy(CICalendarFreeBusy::eBusy, CICalendarPeriod((*iter)->GetInstanceStart(), (*iter)->GetInstanceEnd())));
+				fb.push_back(CICalendarFreeBusy(CICalendarFreeBusy::eBusy, CICalendarPeriod((*iter).GetInstanceStart(), (*iter).GetInstanceEnd())));
 				break;
 			case eStatus_VEvent_Tentative:
-				fb.push_back(CICalendarFreeBusy(CICalendarFreeBusy::eBusyTentative, CICalendarPeriod((*iter)->GetInstanceStart(), (*iter)->GetInstanceEnd())));
+				fb.push_back(CICalendarFreeBusy(CICalendarFreeBusy::eBusyTentative, CICalendarPeriod((*iter).GetInstanceStart(), (*iter).GetInstanceEnd())));
 				break;
 			case eStatus_VEvent_Cancelled:
 				// Cancelled => does not contribute to busy time
@@ -878,6 +1026,9 @@ void CICalendar::GetFreeBusyOnly(CICalendarFreeBusyList& fb) const
 // Merge timezones
 void CICalendar::MergeTimezones(const CICalendar& cal)
 {
+	// Copies belong to this calendar
+	CICalendarArena::StUseArena use_arena(mArena);
+
 	// Merge each timezone from other calendar
 	for(CICalendarComponentDB::const_iterator iter = cal.mVTimezone.begin(); iter != cal.mVTimezone.end(); iter++)
 	{
@@ -899,77 +1050,164 @@ void CICalendar::MergeTimezones(const CICalendar& cal)
 int32_t CICalendar::GetTimezoneOffsetSeconds(const cdstring& timezone, const CICalendarDateTime& dt)
 {
 	// Find timezone that matches the name (which is the same as the map key)
-	CICalendarComponentDB::const_iterator found = mVTimezone.find(timezone);
-	if (found != mVTimezone.end())
+	const CICalendarVTimezone* tz = FindTimezone(timezone);
+	if (tz != NULL)
+		return const_cast<CICalendarVTimezone*>(tz)->GetTimezoneOffsetSeconds(dt);
+	else
+		return GetTableTimezoneOffsetSeconds(timezone, dt);
+}
+
+// Timezone not loaded yet
+int32_t CICalendar::GetTableTimezoneOffsetSeconds(const cdstring& timezone, const CICalendarDateTime& dt)
+{
+	if (mTimezoneTable != NULL)
 	{
-		return static_cast<CICalendarVTimezone*>((*found).second)->GetTimezoneOffsetSeconds(dt);
+		// Try precompiled table - fall back to the full timezone if out of range
+		int32_t offset = 0;
+		if (mTimezoneTable->GetTimezoneOffsetSeconds(timezone, dt, offset))
+			return offset;
+		else if (LoadTableTimezone(timezone))
+			return GetTimezoneOffsetSeconds(timezone, dt);
 	}
-	else
-		return 0;
+
+	return 0;
 }
 
 // Timezone lookups
 cdstring CICalendar::GetTimezoneDescriptor(const cdstring& timezone, const CICalendarDateTime& dt)
 {
 	// Find timezone that matches the name (which is the same as the map key)
-	CICalendarComponentDB::const_iterator found = mVTimezone.find(timezone);
-	if (found != mVTimezone.end())
+	const CICalendarVTimezone* tz = FindTimezone(timezone);
+	if (tz != NULL)
+		return const_cast<CICalendarVTimezone*>(tz)->GetTimezoneDescriptor(dt);
+	else
+		return GetTableTimezoneDescriptor(timezone, dt);
+}
+
+// Timezone not loaded yet
+cdstring CICalendar::GetTableTimezoneDescriptor(const cdstring& timezone, const CICalendarDateTime& dt)
+{
+	if (mTimezoneTable != NULL)
 	{
-		return static_cast<CICalendarVTimezone*>((*found).second)->GetTimezoneDescriptor(dt);
+		// Try precompiled table - fall back to the full timezone if out of range
+		cdstring desc;
+		if (mTimezoneTable->GetTimezoneDescriptor(timezone, dt, desc))
+			return desc;
+		else if (LoadTableTimezone(timezone))
+			return GetTimezoneDescriptor(timezone, dt);
 	}
-	else
-		return cdstring::null_str;
+
+	return cdstring::null_str;
 }
 
 void CICalendar::GetTimezones(cdstrvect& tzids) const
 {
 	// Get all timezones in a list for sorting
-	typedef std::multimap<int32_t, CICalendarComponent*> CSortedComponentMap;
-	CSortedComponentMap sorted;
+	typedef std::multimap<int32_t, cdstring> CSortedTimezoneMap;
+	CSortedTimezoneMap sorted;
 	for(CICalendarComponentDB::const_iterator iter = mVTimezone.begin(); iter != mVTimezone.end(); iter++)
 	{
-		sorted.insert(CSortedComponentMap::value_type(static_cast<CICalendarVTimezone*>((*iter).second)->GetSortKey(), (*iter).second));
+		const CICalendarVTimezone* tz = static_cast<const CICalendarVTimezone*>((*iter).second);
+		sorted.insert(CSortedTimezoneMap::value_type(tz->GetSortKey(), tz->GetID()));
+	}
+
+	// Add the precompiled ones not already loaded
+	if (mTimezoneTable != NULL)
+	{
+		cdstrvect table_tzids;
+		mTimezoneTable->GetTimezones(table_tzids);
+		for(cdstrvect::const_iterator iter = table_tzids.begin(); iter != table_tzids.end(); iter++)
+		{
+			if (mVTimezone.find(*iter) == mVTimezone.end())
+				sorted.insert(CSortedTimezoneMap::value_type(mTimezoneTable->GetSortKey(*iter), *iter));
+		}
 	}
 	
 	// Now add to list in sorted order
-	for(CSortedComponentMap::const_iterator iter = sorted.begin(); iter != sorted.end(); iter++)
+	for(CSortedTimezoneMap::const_iterator iter = sorted.begin(); iter != sorted.end(); iter++)
 	{
-		tzids.push_back(static_cast<CICalendarVTimezone*>((*iter).second)->GetID());
+		tzids.push_back((*iter).second);
 	}
 }
 
 void CICalendar::SortTimezones(cdstrvect& tzids) const
 {
 	// Get all timezones in a list for sorting
-	typedef std::multimap<int32_t, const CICalendarComponent*> CSortedComponentMap;
-	CSortedComponentMap sorted;
+	typedef std::multimap<int32_t, cdstring> CSortedTimezoneMap;
+	CSortedTimezoneMap sorted;
 	for(cdstrvect::const_iterator iter = tzids.begin(); iter != tzids.end(); iter++)
 	{
-		const CICalendarVTimezone* tz = GetTimezone(*iter);
-		if (tz != NULL)
-			sorted.insert(CSortedComponentMap::value_type(tz->GetSortKey(), tz));
+		int32_t key = 0;
+		if (GetTimezoneSortKey(*iter, key))
+			sorted.insert(CSortedTimezoneMap::value_type(key, *iter));
 	}
 	
 	// Now add to list in sorted order
 	tzids.clear();
-	for(CSortedComponentMap::const_iterator iter = sorted.begin(); iter != sorted.end(); iter++)
+	for(CSortedTimezoneMap::const_iterator iter = sorted.begin(); iter != sorted.end(); iter++)
+	{
+		tzids.push_back((*iter).second);
+	}
+}
+
+bool CICalendar::GetTimezoneSortKey(const cdstring& tzid, int32_t& key) const
+{
+	const CICalendarVTimezone* tz = FindTimezone(tzid);
+	if (tz != NULL)
 	{
-		tzids.push_back(static_cast<const CICalendarVTimezone*>((*iter).second)->GetID());
+		key = tz->GetSortKey();
+		return true;
+	}
+	else if ((mTimezoneTable != NULL) && mTimezoneTable->HasTimezone(tzid))
+	{
+		key = mTimezoneTable->GetSortKey(tzid);
+		return true;
 	}
+	else
+		return false;
 }
 
 const CICalendarVTimezone* CICalendar::GetTimezone(const cdstring& tzid) const
 {
 	// Find timezone that matches the name (which is the same as the map key)
-	CICalendarComponentDB::const_iterator found = mVTimezone.find(tzid);
-	if (found != mVTimezone.end())
+	const CICalendarVTimezone* tz = FindTimezone(tzid);
+	if (tz != NULL)
 	{
-		return static_cast<CICalendarVTimezone*>((*found).second);
+		return tz;
+	}
+	else if ((mTimezoneTable != NULL) && const_cast<CICalendar*>(this)->LoadTableTimezone(tzid))
+	{
+		return GetTimezone(tzid);
 	}
 	else
 		return NULL;
 }
 
+// Only one already loaded - not one just in the precompiled table
+const CICalendarVTimezone* CICalendar::FindTimezone(const cdstring& tzid) const
+{
+	CICalendarMutex::StLock lock(mTimezoneMutex);
+	CICalendarComponentDB::const_iterator found = mVTimezone.find(tzid);
+	return (found != mVTimezone.end()) ? static_cast<const CICalendarVTimezone*>((*found).second) : NULL;
+}
+
+// Create the full timezone component from its definition in the precompiled table
+bool CICalendar::LoadTableTimezone(const cdstring& tzid)
+{
+	// Concurrent lookups may both get here for the same timezone
+	CICalendarMutex::StLock lock(mTimezoneMutex);
+	if (mVTimezone.find(tzid) != mVTimezone.end())
+		return true;
+
+	const char* data = NULL;
+	size_t length = 0;
+	if ((mTimezoneTable == NULL) || !mTimezoneTable->GetTimezoneDefinition(tzid, data, length))
+		return false;
+
+	Parse(data, length);
+	return mVTimezone.find(tzid) != mVTimezone.end();
+}
+
 void CICalendar::IncludeTimezones()
 {
 	// Get timezone names from each component
@@ -1032,12 +1270,26 @@ void CICalendar::ChangedComponent(CICalendarComponent* comp)
 	
 	// Record change
 	CICalendarComponentRecord::RecordAction(mRecordDB, comp, CICalendarComponentRecord::eChanged);
+
+	// Timing and instances may have changed
+	if (comp->GetType() == CICalendarComponent::eVEVENT)
+	{
+		mVEventIntervals.Update(static_cast<CICalendarComponentRecur*>(comp));
+		mVEventInstances.Invalidate(comp->GetUID());
+	}
 	
 	// Broadcast change
 	CComponentAction action(CComponentAction::eChanged, *this, *comp);
 	Broadcast_Message(eBroadcast_ChangedComponent, &action);
 }
 
+void CICalendar::ChangedRecurrence(const CICalendarComponentRecur* comp)
+{
+	// Expanded instances are out of date
+	if (comp->GetType() == CICalendarComponent::eVEVENT)
+		mVEventInstances.Invalidate(comp->GetUID());
+}
+
 void CICalendar::AddNewVEvent(CICalendarVEvent* vevent, bool moved)
 {
 	// Do not init props if moving
@@ -1259,6 +1511,10 @@ void CICalendar::AddComponent(CICalendarComponentDB& db, CICalendarComponent* co
 
 const CICalendarComponent* CICalendar::GetComponentByKey(const cdstring& mapkey) const
 {
+	// Single lookup unless a key is shared between component types
+	if (!mKeyIndex.HasCollisions())
+		return mKeyIndex.Find(mapkey);
+
 	const CICalendarComponent* result = NULL;
 
 	result = GetComponentByKey(mVEvent, mapkey);
@@ -1286,6 +1542,10 @@ const CICalendarComponent* CICalendar::GetComponentByKey(const cdstring& mapkey)
 
 CICalendarComponent* CICalendar::GetComponentByKey(const cdstring& mapkey)
 {
+	// Single lookup unless a key is shared between component types
+	if (!mKeyIndex.HasCollisions())
+		return mKeyIndex.Find(mapkey);
+
 	CICalendarComponent* result = NULL;
 
 	result = GetComponentByKey(mVEvent, mapkey);
@@ -1331,6 +1591,15 @@ CICalendarComponent* CICalendar::GetComponentByKey(CICalendarComponentDB& db, co
 
 void CICalendar::RemoveComponentByKey(const cdstring& mapkey)
 {
+	// Index gives the type and so the DB to remove it from
+	if (!mKeyIndex.HasCollisions())
+	{
+		CICalendarComponent* result = mKeyIndex.Find(mapkey);
+		if (result != NULL)
+			GetComponents(result->GetType()).RemoveComponent(result, true);
+		return;
+	}
+
 	if (RemoveComponentByKey(mVEvent, mapkey))
 		return;
 
@@ -1359,6 +1628,19 @@ bool CICalendar::RemoveComponentByKey(CICalendarComponentDB& db, const cdstring&
 		return false;
 }
 
+void CICalendar::GetComponentsByKey(const cdstrvect& mapkeys, CICalendarConstComponentList& comps) const
+{
+	comps.reserve(comps.size() + mapkeys.size());
+	for(cdstrvect::const_iterator iter = mapkeys.begin(); iter != mapkeys.end(); iter++)
+		comps.push_back(GetComponentByKey(*iter));
+}
+
+void CICalendar::RemoveComponentsByKey(const cdstrvect& mapkeys)
+{
+	for(cdstrvect::const_iterator iter = mapkeys.begin(); iter != mapkeys.end(); iter++)
+		RemoveComponentByKey(*iter);
+}
+
 #pragma mark ____________________________Disconnected
 
 // XML DTD
@@ -1421,6 +1703,13 @@ void CICalendar::ClearSync()
 	mVJournal.RemoveAllComponents();
 	mVFreeBusy.RemoveAllComponents();
 	mVTimezone.RemoveAllComponents();    
+
+	// Free old parsed data in one go and start a new arena
+	if (mArena != NULL)
+	{
+		mArena->Release();
+		mArena = new CICalendarArena;
+	}
 }
 
 void CICalendar::ParseCache(std::istream& is)
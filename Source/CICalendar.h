@@ -31,6 +31,7 @@
 #include "CICalendarComponent.h"
 #include "CICalendarComponentDB.h"
 #include "CICalendarFreeBusy.h"
+#include "CICalendarMutex.h"
 #include "CICalendarPeriod.h"
 
 #include "cdsharedptr.h"
@@ -41,6 +42,7 @@
 namespace iCal {
 
 class CICalendarProperty;
+class CICalendarTimezoneTable;
 class CICalendarVEvent;
 class CICalendarVTimezone;
 class CICalendarVToDo;
@@ -48,10 +50,15 @@ class CICalendarVToDo;
 class CICalendarComponentRecur;
 typedef std::vector<CICalendarComponentRecur*> CICalendarComponentRecurs;
 
+typedef std::vector<const CICalendarComponent*> CICalendarConstComponentList;
+
 class CICalendarComponentExpanded;
 typedef cdsharedptr<CICalendarComponentExpanded> CICalendarComponentExpandedShared;
 typedef std::vector<CICalendarComponentExpandedShared> CICalendarExpandedComponents;
 
+class CICalendarInstance;
+typedef std::vector<CICalendarInstance> CICalendarInstanceList;
+
 typedef uint32_t	CICalendarRef;	// Unique reference to object
 
 class CICalendar : public CICalendarComponentBase, public CBroadcaster
@@ -126,6 +133,17 @@ public:
 
 	void Clear();
 
+	// Components, properties and values created by Parse come from an arena
+	bool GetUseArena() const
+		{ return mArena != NULL; }
+	void SetUseArena(bool use_arena);
+
+	// Property values created by Parse are only decoded when first used
+	bool GetLazyValues() const
+		{ return mLazyValues; }
+	void SetLazyValues(bool lazy)
+		{ mLazyValues = lazy; }
+
 	cdstring& GetName()
 		{ return mName; }
 	const cdstring& GetName() const
@@ -147,6 +165,7 @@ public:
 	virtual void Finalise();
 
 	bool					Parse(std::istream& is);
+	bool					Parse(const char* data, size_t length);
 	CICalendarComponent*	ParseComponent(std::istream& is, const cdstring& rurl, const cdstring& etag);
 	virtual void			Generate(std::ostream& os, bool for_cache = false) const;
 	virtual void			GenerateOne(std::ostream& os, const CICalendarComponent& comp) const;
@@ -220,8 +239,10 @@ public:
 	void	ParseCache(std::istream& is);
 	void	GenerateCache(std::ostream& os) const;
 
-	// Get expanded components
+	// Get expanded components - queries may run on several threads at once provided nothing
+	// changes the calendar at the same time
 	void GetVEvents(const CICalendarPeriod& period, CICalendarExpandedComponents& list, bool all_day_at_top = true) const;
+	void GetVEvents(const CICalendarPeriod& period, CICalendarInstanceList& list, bool all_day_at_top = true) const;
 	void GetVToDos(bool only_due, bool all_dates, const CICalendarDateTime& upto_due_date, CICalendarExpandedComponents& list) const;
 	void GetRecurrenceInstances(CICalendarComponent::EComponentType type, const cdstring& uid, CICalendarComponentRecurs& items) const;
 	void GetRecurrenceInstances(CICalendarComponent::EComponentType type, const cdstring& uid, CICalendarDateTimeList& ids) const;
@@ -236,12 +257,25 @@ public:
 	void	MergeTimezones(const CICalendar& cal);
 	int32_t GetTimezoneOffsetSeconds(const cdstring& timezone, const CICalendarDateTime& dt);
 	cdstring GetTimezoneDescriptor(const cdstring& timezone, const CICalendarDateTime& dt);
+	int32_t GetTableTimezoneOffsetSeconds(const cdstring& timezone, const CICalendarDateTime& dt);
+	cdstring GetTableTimezoneDescriptor(const cdstring& timezone, const CICalendarDateTime& dt);
 	void	GetTimezones(cdstrvect& tzids) const;
 	void	SortTimezones(cdstrvect& tzids) const;
 	const CICalendarVTimezone* GetTimezone(const cdstring& tzid) const;
+	const CICalendarVTimezone* FindTimezone(const cdstring& tzid) const;
 	bool ValidEDST(cdstrvect& tzids) const;
 	void UpgradeEDST();
 
+	// Precompiled timezones used when no VTIMEZONE is present (not owned)
+	const CICalendarTimezoneTable* GetTimezoneTable() const
+	{
+		return mTimezoneTable;
+	}
+	void	SetTimezoneTable(const CICalendarTimezoneTable* table)
+	{
+		mTimezoneTable = table;
+	}
+
 	// Add/remove components
 	enum ERemoveRecurring
 	{
@@ -251,6 +285,7 @@ public:
 	};
 
 	void	ChangedComponent(CICalendarComponent* comp);
+	void	ChangedRecurrence(const CICalendarComponentRecur* comp);
 
 	void	AddNewVEvent(CICalendarVEvent* vevent, bool moved = false);
 	void	RemoveVEvent(CICalendarVEvent* vevent, bool delete_it = true);
@@ -266,6 +301,10 @@ public:
 	CICalendarComponent* GetComponentByKey(const cdstring& mapkey);
 	void RemoveComponentByKey(const cdstring& mapkey);
 
+	// Batch versions - results match the order of the keys with NULL for any not found
+	void GetComponentsByKey(const cdstrvect& mapkeys, CICalendarConstComponentList& comps) const;
+	void RemoveComponentsByKey(const cdstrvect& mapkeys);
+
 	bool	IsReadOnly() const
 	{
 		return mReadOnly;
@@ -314,6 +353,15 @@ protected:
 	CICalendarComponentDB		mVJournal;
 	CICalendarComponentDB		mVFreeBusy;
 	CICalendarComponentDB		mVTimezone;
+	CICalendarComponentKeyIndex	mKeyIndex;
+	CICalendarIntervalIndex		mVEventIntervals;
+	CICalendarInstanceCache		mVEventInstances;
+	mutable CICalendarMutex		mCacheMutex;		// Index and cache are filled in by concurrent queries
+	mutable CICalendarMutex		mTimezoneMutex;		// Table timezones are loaded by concurrent lookups
+
+	const CICalendarTimezoneTable*	mTimezoneTable;
+	CICalendarArena*				mArena;
+	bool							mLazyValues;
 	
 	// Pseudo properties used for disconnected cache
 	cdstring					mETag;
@@ -335,6 +383,8 @@ protected:
 
 	void	IncludeTimezones();
 	void	IncludeTimezones(const CICalendarComponentDB& components, cdstrset& tzids);
+	bool	GetTimezoneSortKey(const cdstring& tzid, int32_t& key) const;
+	bool	LoadTableTimezone(const cdstring& tzid);
 
 	CICalendarComponent* FindComponent(const CICalendarComponentDB& db, const CICalendarComponent* orig, EFindComponent find = eFindExact) const;
 	void AddComponent(CICalendarComponentDB& db, CICalendarComponent* comp);
@@ -343,6 +393,30 @@ protected:
 	bool RemoveComponentByKey(CICalendarComponentDB& db, const cdstring& mapkey);
 
 private:
+	enum EParserState
+	{
+		eLookForVCalendar,
+		eGetPropertyOrComponent,
+		eGetComponentProperty,
+		eGetSubComponentProperty
+	};
+
+	// Parser state shared by the stream and buffer parsers
+	struct SParseState
+	{
+		EParserState			mState;
+		bool					mResult;
+		CICalendarComponent*	mComp;
+		CICalendarComponent*	mPrevComp;
+		CICalendarComponentDB*	mCompMap;
+
+		SParseState()
+			: mState(eLookForVCalendar), mResult(false), mComp(NULL), mPrevComp(NULL), mCompMap(NULL) {}
+	};
+
+	bool	ParseLine(cdstring& line, SParseState& state);
+	void	ParseDone();
+
 	struct SComponentRegister
 	{
 		CICalendarComponent::CreateComponentPP	mCreatePP;
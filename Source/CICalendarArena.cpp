@@ -0,0 +1,109 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+	CICalendarArena.cpp
+
+	Author:
+	Description:	block allocator for objects created while parsing a calendar
+*/
+
+#include "CICalendarArena.h"
+
+using namespace iCal;
+
+#ifndef __VCPP__
+CICALENDAR_THREAD_LOCAL CICalendarArena* CICalendarArena::sCurrent = NULL;
+#endif
+
+CICalendarArena::CICalendarArena()
+{
+	mNext = NULL;
+	mRemaining = 0;
+	mLive = 0;
+	mReleased = false;
+}
+
+CICalendarArena::~CICalendarArena()
+{
+	for(std::vector<char*>::const_iterator iter = mBlocks.begin(); iter != mBlocks.end(); iter++)
+		delete [] *iter;
+}
+
+void CICalendarArena::Release()
+{
+	// Blocks are freed now or when the last object goes
+	mReleased = true;
+	if (mLive == 0)
+		delete this;
+}
+
+void* CICalendarArena::Allocate(size_t size)
+{
+	SHeader* header;
+	if (sCurrent != NULL)
+	{
+		header = static_cast<SHeader*>(sCurrent->AllocateBlock(sizeof(SHeader) + size));
+		header->mArena = sCurrent;
+		sCurrent->mLive++;
+	}
+	else
+	{
+		header = static_cast<SHeader*>(::operator new(sizeof(SHeader) + size));
+		header->mArena = NULL;
+	}
+
+	return header + 1;
+}
+
+void CICalendarArena::Deallocate(void* p)
+{
+	if (p == NULL)
+		return;
+
+	SHeader* header = static_cast<SHeader*>(p) - 1;
+	CICalendarArena* arena = header->mArena;
+	if (arena == NULL)
+		::operator delete(header);
+	else if ((--arena->mLive == 0) && arena->mReleased)
+		delete arena;
+}
+
+void* CICalendarArena::AllocateBlock(size_t size)
+{
+	// Keep everything aligned the same as the header
+	size = (size + sizeof(SHeader) - 1) / sizeof(SHeader) * sizeof(SHeader);
+
+	// Large items get a block to themselves
+	if (size > cBlockSize / 4)
+	{
+		char* block = new char[size];
+		mBlocks.push_back(block);
+		return block;
+	}
+
+	if (size > mRemaining)
+	{
+		mNext = new char[cBlockSize];
+		mRemaining = cBlockSize;
+		mBlocks.push_back(mNext);
+	}
+
+	void* result = mNext;
+	mNext += size;
+	mRemaining -= size;
+	return result;
+}
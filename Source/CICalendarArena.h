@@ -0,0 +1,144 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+	CICalendarArena.h
+
+	Author:
+	Description:	block allocator for objects created while parsing a calendar
+*/
+
+#ifndef CICalendarArena_H
+#define CICalendarArena_H
+
+#include "CICalendarMutex.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <limits>
+#include <new>
+#include <vector>
+
+namespace iCal {
+
+// Objects allocated via CICalendarArena::Allocate come from the arena that is current on this
+// thread of control, or from the heap if there is none. Deallocate works out which it was.
+// Arena memory is never freed individually - all blocks go once the owner has released the
+// arena and the last object allocated in it has been deallocated.
+
+class CICalendarArena
+{
+public:
+	CICalendarArena();
+
+	// Owner is done with the arena
+	void Release();
+
+	static void*	Allocate(size_t size);
+	static void		Deallocate(void* p);
+
+	// Make an arena current for the lifetime of this object
+	class StUseArena
+	{
+	public:
+		explicit StUseArena(CICalendarArena* arena)
+			{ mPrevious = sCurrent; sCurrent = arena; }
+		~StUseArena()
+			{ sCurrent = mPrevious; }
+
+	private:
+		CICalendarArena*	mPrevious;
+	};
+
+private:
+	// Keeps allocations aligned for any type
+	union SHeader
+	{
+		CICalendarArena*	mArena;
+		long double			mAlign1;
+		int64_t				mAlign2;
+		void*				mAlign3;
+	};
+
+	static const size_t		cBlockSize = 64 * 1024;
+
+	static CICALENDAR_THREAD_LOCAL CICalendarArena*	sCurrent;
+
+	std::vector<char*>	mBlocks;
+	char*				mNext;
+	size_t				mRemaining;
+	uint32_t			mLive;
+	bool				mReleased;
+
+	~CICalendarArena();
+
+	void*	AllocateBlock(size_t size);
+
+	// Not copyable
+	CICalendarArena(const CICalendarArena& copy);
+	CICalendarArena& operator=(const CICalendarArena& copy);
+};
+
+// STL allocator that uses the current arena
+template <class T> class CICalendarArenaAllocator
+{
+public:
+	typedef T				value_type;
+	typedef T*				pointer;
+	typedef const T*		const_pointer;
+	typedef T&				reference;
+	typedef const T&		const_reference;
+	typedef size_t			size_type;
+	typedef ptrdiff_t		difference_type;
+
+	template <class U> struct rebind
+	{
+		typedef CICalendarArenaAllocator<U> other;
+	};
+
+	CICalendarArenaAllocator() {}
+	CICalendarArenaAllocator(const CICalendarArenaAllocator&) {}
+	template <class U> CICalendarArenaAllocator(const CICalendarArenaAllocator<U>&) {}
+	~CICalendarArenaAllocator() {}
+
+	pointer address(reference x) const
+		{ return &x; }
+	const_pointer address(const_reference x) const
+		{ return &x; }
+
+	pointer allocate(size_type n, const void* = 0)
+		{ return static_cast<pointer>(CICalendarArena::Allocate(n * sizeof(T))); }
+	void deallocate(pointer p, size_type)
+		{ CICalendarArena::Deallocate(p); }
+
+	size_type max_size() const
+		{ return std::numeric_limits<size_type>::max() / sizeof(T); }
+
+	void construct(pointer p, const T& val)
+		{ new(static_cast<void*>(p)) T(val); }
+	void destroy(pointer p)
+		{ p->~T(); }
+
+	// All instances are interchangeable
+	template <class U> bool operator==(const CICalendarArenaAllocator<U>&) const
+		{ return true; }
+	template <class U> bool operator!=(const CICalendarArenaAllocator<U>&) const
+		{ return false; }
+};
+
+}	// namespace iCal
+
+#endif	// CICalendarArena_H
@@ -23,24 +23,234 @@
 
 #include "CICalendarAttribute.h"
 
-#include <iostream>
+#include <cstring>
+#include <deque>
+#include <map>
 
 using namespace iCal;
 
+// Must match the order of EAttributeKey
+static const char* cKnownNames[CICalendarAttribute::eKnownCount] =
+{
+	"ALTREP",
+	"CN",
+	"CUTYPE",
+	"DELEGATED-FROM",
+	"DELEGATED-TO",
+	"DIR",
+	"ENCODING",
+	"FBTYPE",
+	"FMTTYPE",
+	"LANGUAGE",
+	"MEMBER",
+	"PARTSTAT",
+	"RANGE",
+	"RELATED",
+	"RELTYPE",
+	"ROLE",
+	"RSVP",
+	"SENT-BY",
+	"TZID",
+	"VALUE"
+};
+
+// Deque so that references to names remain valid as it grows
+typedef std::deque<cdstring> CKeyNames;
+typedef std::map<cdstring, uint32_t> CNameKeys;
+
+// Function statics so that these are available during static initialisation
+static CKeyNames& GetKeyNames()
+{
+	static CKeyNames sNames(cKnownNames, cKnownNames + CICalendarAttribute::eKnownCount);
+	return sNames;
+}
+
+static CNameKeys& GetInternedKeys()
+{
+	static CNameKeys sKeys;
+	return sKeys;
+}
+
+uint32_t CICalendarAttribute::GetKey(const char* name)
+{
+	uint32_t key;
+	if (FindKey(name, key))
+		return key;
+
+	// Add new entry
+	CKeyNames& names = GetKeyNames();
+	key = names.size();
+	names.push_back(name);
+	GetInternedKeys().insert(CNameKeys::value_type(name, key));
+
+	return key;
+}
+
+// Returns false for a name that has never been used by any attribute
+bool CICalendarAttribute::FindKey(const char* name, uint32_t& key)
+{
+	// Binary search on known names
+	uint32_t lo = 0;
+	uint32_t hi = eKnownCount;
+	while(lo < hi)
+	{
+		uint32_t mid = (lo + hi) / 2;
+		int result = ::strcmp(cKnownNames[mid], name);
+		if (result == 0)
+		{
+			key = mid;
+			return true;
+		}
+		else if (result < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	const CNameKeys& keys = GetInternedKeys();
+	CNameKeys::const_iterator found = keys.find(name);
+	if (found == keys.end())
+		return false;
+
+	key = (*found).second;
+	return true;
+}
+
+const cdstring& CICalendarAttribute::GetName() const
+{
+	return GetKeyNames()[mKey];
+}
+
+int CICalendarAttribute::CompareName(uint32_t key) const
+{
+	if (mKey == key)
+		return 0;
+	else if ((mKey < eKnownCount) && (key < eKnownCount))
+		return (mKey < key) ? -1 : 1;
+	else
+		return ::strcmp(GetName().c_str(), GetKeyNames()[key].c_str());
+}
+
+void CICalendarAttribute::AddValue(const cdstring& value)
+{
+	if (!mHasValue)
+	{
+		mValue = value;
+		mHasValue = true;
+	}
+	else
+	{
+		if (mMoreValues == NULL)
+			mMoreValues = new cdstrvect;
+		mMoreValues->push_back(value);
+	}
+}
 
 void CICalendarAttribute::Generate(std::ostream& os) const
 {
-	os << mName << "=";
+	os << GetName() << "=";
 
-	for(cdstrvect::const_iterator iter = mValues.begin(); iter != mValues.end(); iter++)
+	for(uint32_t i = 0; i < CountValues(); i++)
 	{
-		if (iter != mValues.begin())
+		if (i != 0)
 			os << ',';
 
 		// Look for quoting
-		if ((*iter).find_first_of(":;,") != cdstring::npos)
-			os << '"' << *iter << '"';
+		const cdstring& value = GetValue(i);
+		if (value.find_first_of(":;,") != cdstring::npos)
+			os << '"' << value << '"';
+		else
+			os << value;
+	}
+}
+
+void CICalendarAttribute::_copy_CICalendarAttribute(const CICalendarAttribute& copy)
+{
+	_tidy_CICalendarAttribute();
+	mKey = copy.mKey;
+	mHasValue = copy.mHasValue;
+	mValue = copy.mValue;
+	if (copy.mMoreValues != NULL)
+		mMoreValues = new cdstrvect(*copy.mMoreValues);
+}
+
+#pragma mark ____________________________CICalendarAttributeMap
+
+void CICalendarAttributeMap::insert(const CICalendarAttribute& attr)
+{
+	// Insert after any with the same name
+	CAttributes::iterator iter = mAttributes.end();
+	while((iter != mAttributes.begin()) && ((*(iter - 1)).CompareName(attr.GetKey()) > 0))
+		iter--;
+	mAttributes.insert(iter, attr);
+}
+
+uint32_t CICalendarAttributeMap::erase(const char* name)
+{
+	uint32_t key;
+	return CICalendarAttribute::FindKey(name, key) ? EraseKey(key) : 0;
+}
+
+CICalendarAttributeMap::iterator CICalendarAttributeMap::find(const char* name)
+{
+	uint32_t key;
+	return CICalendarAttribute::FindKey(name, key) ? FindKey(key) : mAttributes.end();
+}
+
+CICalendarAttributeMap::const_iterator CICalendarAttributeMap::find(const char* name) const
+{
+	uint32_t key;
+	return CICalendarAttribute::FindKey(name, key) ? FindKey(key) : mAttributes.end();
+}
+
+uint32_t CICalendarAttributeMap::count(const char* name) const
+{
+	uint32_t key;
+	if (!CICalendarAttribute::FindKey(name, key))
+		return 0;
+
+	uint32_t result = 0;
+	for(CAttributes::const_iterator iter = mAttributes.begin(); iter != mAttributes.end(); iter++)
+	{
+		if ((*iter).GetKey() == key)
+			result++;
+	}
+	return result;
+}
+
+CICalendarAttributeMap::iterator CICalendarAttributeMap::FindKey(uint32_t key)
+{
+	for(CAttributes::iterator iter = mAttributes.begin(); iter != mAttributes.end(); iter++)
+	{
+		if ((*iter).GetKey() == key)
+			return iter;
+	}
+	return mAttributes.end();
+}
+
+CICalendarAttributeMap::const_iterator CICalendarAttributeMap::FindKey(uint32_t key) const
+{
+	for(CAttributes::const_iterator iter = mAttributes.begin(); iter != mAttributes.end(); iter++)
+	{
+		if ((*iter).GetKey() == key)
+			return iter;
+	}
+	return mAttributes.end();
+}
+
+uint32_t CICalendarAttributeMap::EraseKey(uint32_t key)
+{
+	uint32_t result = 0;
+	CAttributes::iterator iter = mAttributes.begin();
+	while(iter != mAttributes.end())
+	{
+		if ((*iter).GetKey() == key)
+		{
+			iter = mAttributes.erase(iter);
+			result++;
+		}
 		else
-			os << *iter;
+			iter++;
 	}
+	return result;
 }
@@ -24,7 +24,10 @@
 #ifndef CICalendarAttribute_H
 #define CICalendarAttribute_H
 
-#include <map>
+#include "CICalendarArena.h"
+
+#include <stdint.h>
+#include <iostream>
 #include <vector>
 
 #include "cdstring.h"
@@ -35,44 +38,144 @@ namespace iCal {
 class CICalendarAttribute
 {
 public:
-	CICalendarAttribute() {}
+	// Known parameter names in the same order as the names sort
+	enum EAttributeKey
+	{
+		eALTREP,
+		eCN,
+		eCUTYPE,
+		eDELEGATED_FROM,
+		eDELEGATED_TO,
+		eDIR,
+		eENCODING,
+		eFBTYPE,
+		eFMTTYPE,
+		eLANGUAGE,
+		eMEMBER,
+		ePARTSTAT,
+		eRANGE,
+		eRELATED,
+		eRELTYPE,
+		eROLE,
+		eRSVP,
+		eSENT_BY,
+		eTZID,
+		eVALUE,
+
+		// Interned names start here
+		eKnownCount
+	};
+
+	CICalendarAttribute()
+		{ _init_CICalendarAttribute(); mKey = GetKey(""); mHasValue = false; }
+	CICalendarAttribute(const char* name, const cdstring& value)
+		{ _init_CICalendarAttribute(); mKey = GetKey(name); mValue = value; }
 	CICalendarAttribute(const cdstring& name, const cdstring& value)
-		{ mName = name; mValues.push_back(value); }
+		{ _init_CICalendarAttribute(); mKey = GetKey(name.c_str()); mValue = value; }
+	CICalendarAttribute(EAttributeKey key, const cdstring& value)
+		{ _init_CICalendarAttribute(); mKey = key; mValue = value; }
 	CICalendarAttribute(const CICalendarAttribute& copy)
-		{ _copy(copy); }
-	virtual ~CICalendarAttribute() {}
+		{ _init_CICalendarAttribute(); _copy_CICalendarAttribute(copy); }
+	virtual ~CICalendarAttribute()
+		{ _tidy_CICalendarAttribute(); }
 
 	CICalendarAttribute& operator=(const CICalendarAttribute& copy)
-		{ if (this != &copy) _copy(copy); return *this; }
+		{ if (this != &copy) _copy_CICalendarAttribute(copy); return *this; }
+
+	// Key for a name - X- and IANA names are interned on first use
+	static uint32_t GetKey(const char* name);
+	static bool FindKey(const char* name, uint32_t& key);
 
-	cdstring& GetName()
-		{ return mName; }
-	const cdstring& GetName() const
-		{ return mName; }
+	uint32_t GetKey() const
+		{ return mKey; }
+	const cdstring& GetName() const;
 	void SetName(const cdstring& name)
-		{ mName = name; }
+		{ mKey = GetKey(name.c_str()); }
+
+	// Same ordering as comparing the names
+	int CompareName(uint32_t key) const;
 
+	uint32_t CountValues() const
+		{ return mHasValue ? ((mMoreValues != NULL) ? mMoreValues->size() + 1 : 1) : 0; }
 	const cdstring& GetFirstValue() const
-		{ return mValues.front(); }
-	cdstrvect& GetValues()
-		{ return mValues; }
-	const cdstrvect& GetValues() const
-		{ return mValues; }
-	void AddValue(const cdstring& value)
-		{ mValues.push_back(value); }
+		{ return mValue; }
+	const cdstring& GetValue(uint32_t index) const
+		{ return (index == 0) ? mValue : (*mMoreValues)[index - 1]; }
+	void AddValue(const cdstring& value);
+	void SetValue(const cdstring& value)
+		{ _tidy_CICalendarAttribute(); mValue = value; mHasValue = true; }
 
 	void Generate(std::ostream& os) const;
 
 protected:
-	cdstring		mName;
-	cdstrvect		mValues;
+	uint32_t		mKey;
+	bool			mHasValue;
+	cdstring		mValue;
+	cdstrvect*		mMoreValues;			// Only when there is more than one value
 
 private:
-	void _copy(const CICalendarAttribute& copy)
-		{ mName = copy.mName; mValues = copy.mValues; }
+	void _init_CICalendarAttribute()
+		{ mHasValue = true; mMoreValues = NULL; }
+	void _copy_CICalendarAttribute(const CICalendarAttribute& copy);
+	void _tidy_CICalendarAttribute()
+		{ delete mMoreValues; mMoreValues = NULL; }
 };
 
-typedef std::multimap<cdstring, CICalendarAttribute> CICalendarAttributeMap;
+// Attributes of one property sorted by name, equal names in the order they were added
+class CICalendarAttributeMap
+{
+public:
+	typedef std::vector<CICalendarAttribute, CICalendarArenaAllocator<CICalendarAttribute> > CAttributes;
+	typedef CAttributes::iterator			iterator;
+	typedef CAttributes::const_iterator		const_iterator;
+
+	iterator begin()
+		{ return mAttributes.begin(); }
+	const_iterator begin() const
+		{ return mAttributes.begin(); }
+	iterator end()
+		{ return mAttributes.end(); }
+	const_iterator end() const
+		{ return mAttributes.end(); }
+
+	bool empty() const
+		{ return mAttributes.empty(); }
+	uint32_t size() const
+		{ return mAttributes.size(); }
+
+	void insert(const CICalendarAttribute& attr);
+
+	uint32_t erase(const char* name);
+	uint32_t erase(const cdstring& name)
+		{ return erase(name.c_str()); }
+	uint32_t erase(CICalendarAttribute::EAttributeKey key)
+		{ return EraseKey(key); }
+	void clear()
+		{ mAttributes.clear(); }
+
+	// Attribute lists are short so these just scan the keys
+	iterator find(const char* name);
+	const_iterator find(const char* name) const;
+	iterator find(const cdstring& name)
+		{ return find(name.c_str()); }
+	const_iterator find(const cdstring& name) const
+		{ return find(name.c_str()); }
+	iterator find(CICalendarAttribute::EAttributeKey key)
+		{ return FindKey(key); }
+	const_iterator find(CICalendarAttribute::EAttributeKey key) const
+		{ return FindKey(key); }
+
+	uint32_t count(const char* name) const;
+	uint32_t count(const cdstring& name) const
+		{ return count(name.c_str()); }
+
+private:
+	CAttributes		mAttributes;
+
+	iterator		FindKey(uint32_t key);
+	const_iterator	FindKey(uint32_t key) const;
+	uint32_t		EraseKey(uint32_t key);
+};
 
 }	// namespace iCal
 
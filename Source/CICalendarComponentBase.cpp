@@ -38,13 +38,14 @@ using namespace iCal;
 // Integers can be read from varios types of value
 bool CICalendarComponentBase::LoadValue(const char* value_name, int32_t& value, CICalendarValue::EICalValueType type) const
 {
-	if (GetProperties().count(value_name))
+	CICalendarPropertyMap::const_iterator found = GetProperties().find(value_name);
+	if (found != GetProperties().end())
 	{
 		switch(type)
 		{
 		case CICalendarValue::eValueType_Integer:
 		{
-			const CICalendarIntegerValue* ivalue = (*GetProperties().find(value_name)).second.GetIntegerValue();
+			const CICalendarIntegerValue* ivalue = (*found).second.GetIntegerValue();
 			if (ivalue != NULL)
 			{
 				value = ivalue->GetValue();
@@ -54,7 +55,7 @@ bool CICalendarComponentBase::LoadValue(const char* value_name, int32_t& value,
 		}
 		case CICalendarValue::eValueType_UTC_Offset:
 		{
-			const CICalendarUTCOffsetValue* uvalue = (*GetProperties().find(value_name)).second.GetUTCOffsetValue();
+			const CICalendarUTCOffsetValue* uvalue = (*found).second.GetUTCOffsetValue();
 			if (uvalue != NULL)
 			{
 				value = uvalue->GetValue();
@@ -71,9 +72,10 @@ bool CICalendarComponentBase::LoadValue(const char* value_name, int32_t& value,
 
 bool CICalendarComponentBase::LoadValue(const char* value_name, cdstring& value) const
 {
-	if (GetProperties().count(value_name))
+	CICalendarPropertyMap::const_iterator found = GetProperties().find(value_name);
+	if (found != GetProperties().end())
 	{
-		const CICalendarPlainTextValue* tvalue = (*GetProperties().find(value_name)).second.GetTextValue();
+		const CICalendarPlainTextValue* tvalue = (*found).second.GetTextValue();
 		if (tvalue != NULL)
 		{
 			value = tvalue->GetValue();
@@ -86,9 +88,10 @@ bool CICalendarComponentBase::LoadValue(const char* value_name, cdstring& value)
 
 bool CICalendarComponentBase::LoadValue(const char* value_name, CICalendarDateTime& value) const
 {
-	if (GetProperties().count(value_name))
+	CICalendarPropertyMap::const_iterator found = GetProperties().find(value_name);
+	if (found != GetProperties().end())
 	{
-		const CICalendarDateTimeValue* dtvalue = (*GetProperties().find(value_name)).second.GetDateTimeValue();
+		const CICalendarDateTimeValue* dtvalue = (*found).second.GetDateTimeValue();
 		if (dtvalue != NULL)
 		{
 			value = dtvalue->GetValue();
@@ -101,9 +104,10 @@ bool CICalendarComponentBase::LoadValue(const char* value_name, CICalendarDateTi
 
 bool CICalendarComponentBase::LoadValue(const char* value_name, CICalendarDuration& value) const
 {
-	if (GetProperties().count(value_name))
+	CICalendarPropertyMap::const_iterator found = GetProperties().find(value_name);
+	if (found != GetProperties().end())
 	{
-		const CICalendarDurationValue* dvalue = (*GetProperties().find(value_name)).second.GetDurationValue();
+		const CICalendarDurationValue* dvalue = (*found).second.GetDurationValue();
 		if (dvalue != NULL)
 		{
 			value = dvalue->GetValue();
@@ -116,9 +120,10 @@ bool CICalendarComponentBase::LoadValue(const char* value_name, CICalendarDurati
 
 bool CICalendarComponentBase::LoadValue(const char* value_name, CICalendarPeriod& value) const
 {
-	if (GetProperties().count(value_name))
+	CICalendarPropertyMap::const_iterator found = GetProperties().find(value_name);
+	if (found != GetProperties().end())
 	{
-		const CICalendarPeriodValue* pvalue = (*GetProperties().find(value_name)).second.GetPeriodValue();
+		const CICalendarPeriodValue* pvalue = (*found).second.GetPeriodValue();
 		if (pvalue != NULL)
 		{
 			value = pvalue->GetValue();
@@ -132,9 +137,9 @@ bool CICalendarComponentBase::LoadValue(const char* value_name, CICalendarPeriod
 bool CICalendarComponentBase::LoadValueRRULE(const char* value_name, CICalendarRecurrenceSet& value, bool add) const
 {
 	// Get RRULEs
-	if (GetProperties().count(value_name))
+	std::pair<CICalendarPropertyMap::const_iterator, CICalendarPropertyMap::const_iterator> result = GetProperties().equal_range(value_name);
+	if (result.first != result.second)
 	{
-		std::pair<CICalendarPropertyMap::const_iterator, CICalendarPropertyMap::const_iterator> result = GetProperties().equal_range(value_name);
 		for(CICalendarPropertyMap::const_iterator iter = result.first; iter != result.second; iter++)
 		{
 			const CICalendarRecurrenceValue* rvalue = (*iter).second.GetRecurrenceValue();
@@ -155,9 +160,9 @@ bool CICalendarComponentBase::LoadValueRRULE(const char* value_name, CICalendarR
 bool CICalendarComponentBase::LoadValueRDATE(const char* value_name, CICalendarRecurrenceSet& value, bool add) const
 {
 	// Get RDATEs
-	if (GetProperties().count(value_name))
+	std::pair<CICalendarPropertyMap::const_iterator, CICalendarPropertyMap::const_iterator> result = GetProperties().equal_range(value_name);
+	if (result.first != result.second)
 	{
-		std::pair<CICalendarPropertyMap::const_iterator, CICalendarPropertyMap::const_iterator> result = GetProperties().equal_range(value_name);
 		for(CICalendarPropertyMap::const_iterator iter = result.first; iter != result.second; iter++)
 		{
 			const CICalendarMultiValue* mvalue = (*iter).second.GetMultiValue();
@@ -227,12 +232,12 @@ void CICalendarComponentBase::SetProperties(const CICalendarPropertyMap& props)
 
 void CICalendarComponentBase::AddProperty(const CICalendarProperty& prop)
 {
-	CICalendarPropertyMap::iterator result = mProperties.insert(CICalendarPropertyMap::value_type(prop.GetName(), prop));
+	mProperties.insert(CICalendarPropertyMap::value_type(prop.GetName(), prop));
 }
 
 bool CICalendarComponentBase::HasProperty(const cdstring& prop) const
 {
-	return mProperties.count(prop) > 0;
+	return mProperties.find(prop) != mProperties.end();
 }
 
 uint32_t CICalendarComponentBase::CountProperty(const cdstring& prop) const
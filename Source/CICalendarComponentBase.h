@@ -24,7 +24,7 @@
 #ifndef CICalendarComponentBase_H
 #define CICalendarComponentBase_H
 
-#include "CICalendarProperty.h"
+#include "CICalendarPropertyMap.h"
 
 #include <stdint.h>
 #include <iostream>
@@ -51,6 +51,12 @@ public:
 	CICalendarComponentBase& operator=(const CICalendarComponentBase& copy)
 		{ if (this != &copy) _copy_CICalendarComponentBase(copy); return *this; }
 
+	// Allocate from the current arena if there is one
+	static void* operator new(size_t size)
+		{ return CICalendarArena::Allocate(size); }
+	static void operator delete(void* p)
+		{ CICalendarArena::Deallocate(p); }
+
 	CICalendarPropertyMap& GetProperties();
 	const CICalendarPropertyMap& GetProperties() const;
 	void SetProperties(const CICalendarPropertyMap& props);
@@ -27,6 +27,31 @@
 
 using namespace iCal;
 
+#pragma mark ____________________________CICalendarComponentKeyIndex
+
+void CICalendarComponentKeyIndex::Add(CICalendarComponent* comp)
+{
+	CICalendarComponent*& entry = mIndex.Insert(comp->GetMapKey().c_str(), comp);
+	if (entry == comp)
+		return;
+
+	// Same type means it replaced an older sequence in the same DB
+	if (entry->GetType() == comp->GetType())
+		entry = comp;
+	else
+		mCollisions++;
+}
+
+void CICalendarComponentKeyIndex::Remove(const CICalendarComponent* comp)
+{
+	// Only if it is the one indexed
+	CICalendarComponent** found = mIndex.Find(comp->GetMapKey().c_str());
+	if ((found != NULL) && (*found == comp))
+		mIndex.Remove(comp->GetMapKey().c_str());
+}
+
+#pragma mark ____________________________CICalendarComponentDB
+
 bool CICalendarComponentDB::AddComponent(CICalendarComponent* comp)
 {
 	// Must have valid UID
@@ -35,44 +60,47 @@ bool CICalendarComponentDB::AddComponent(CICalendarComponent* comp)
 
 	// Add the component to the calendar
 	bool bresult = true;
-	std::pair<CICalendarComponentMap::iterator, bool> result = insert(CICalendarComponentMap::value_type(comp->GetMapKey(), comp));
+	iterator* existing = mIndex.Find(comp->GetMapKey().c_str());
 
 	// See if duplicate
-	if (!result.second)
+	if (existing != NULL)
 	{
 		// Replace existing if sequence is higher
-		if (comp->GetSeq() > (*result.first).second->GetSeq())
+		if (comp->GetSeq() > (**existing).second->GetSeq())
 		{
-			(*result.first).second = comp;
+			if (mIntervalIndex != NULL)
+				mIntervalIndex->Remove(static_cast<CICalendarComponentRecur*>((**existing).second));
+			(**existing).second = comp;
+			if (mKeyIndex != NULL)
+				mKeyIndex->Add(comp);
 			bresult = true;
 		}
 		else
 			bresult = false;
 	}
 	else
+	{
+		iterator result = insert(CICalendarComponentMap::value_type(comp->GetMapKey(), comp)).first;
+		mIndex.Insert(comp->GetMapKey().c_str(), result);
+		if (mKeyIndex != NULL)
+			mKeyIndex->Add(comp);
 		bresult = true;
+	}
 	
 	// Now look for a recurrence component if it was added
 	CICalendarComponentRecur* recur = dynamic_cast<CICalendarComponentRecur*>(comp);
 	if (bresult && (recur != NULL))
 	{
+		if (mIntervalIndex != NULL)
+			mIntervalIndex->Add(recur);
+		if (mInstanceCache != NULL)
+			mInstanceCache->Invalidate(recur->GetUID());
+
 		// Add each overridden instance to the override map
 		if (recur->IsRecurrenceInstance())
 		{
-			// Look for existiung UID->RID map entry
-			CICalendarRecurrenceMap::iterator found = mRecurMap.find(recur->GetUID());
-			if (found != mRecurMap.end())
-			{
-				// Add to existing list
-				(*found).second.push_back(recur->GetRecurrenceID());
-			}
-			else
-			{
-				// Create new entry for this UID
-				CICalendarDateTimeList temp;
-				temp.push_back(recur->GetRecurrenceID());
-				mRecurMap.insert(CICalendarRecurrenceMap::value_type(recur->GetUID(), temp));
-			}
+			// Add to existing UID->RID map entry or create a new one for this UID
+			mRecurMap.Insert(recur->GetUID().c_str(), CICalendarDateTimeList()).push_back(recur->GetRecurrenceID());
 			
 			// Now try and find the master component if it currently exists
 			iterator found2 = find(recur->GetUID());
@@ -80,6 +108,8 @@ bool CICalendarComponentDB::AddComponent(CICalendarComponent* comp)
 			{
 				// Tell the instance who its master is
 				recur->SetMaster(static_cast<CICalendarComponentRecur*>((*found2).second));
+				if (mIntervalIndex != NULL)
+					mIntervalIndex->Update(recur);
 			}
 		}
 		
@@ -88,11 +118,11 @@ bool CICalendarComponentDB::AddComponent(CICalendarComponent* comp)
 		else
 		{
 			// See if master has an entry in the UID->RID map
-			CICalendarRecurrenceMap::iterator found = mRecurMap.find(comp->GetUID());
-			if (found != mRecurMap.end())
+			const CICalendarDateTimeList* found = mRecurMap.Find(comp->GetUID().c_str());
+			if (found != NULL)
 			{
 				// Make sure each instance knows about its master
-				const CICalendarDateTimeList& recurs = (*found).second;
+				const CICalendarDateTimeList& recurs = *found;
 				for(CICalendarDateTimeList::const_iterator iter = recurs.begin(); iter != recurs.end(); iter++)
 				{
 					// Get the instance
@@ -101,6 +131,8 @@ bool CICalendarComponentDB::AddComponent(CICalendarComponent* comp)
 					{
 						// Tell the instance who its master is
 						static_cast<CICalendarComponentRecur*>(instance)->SetMaster(recur);
+						if (mIntervalIndex != NULL)
+							mIntervalIndex->Update(instance);
 					}
 				}
 			}
@@ -120,7 +152,18 @@ void CICalendarComponentDB::RemoveComponent(CICalendarComponent* comp, bool dele
 	comp->Removed();
 
 	// Only if present
-	erase(comp->GetMapKey());
+	iterator found = find(comp->GetMapKey());
+	if (found != end())
+	{
+		mIndex.Remove(comp->GetMapKey().c_str());
+		if (mKeyIndex != NULL)
+			mKeyIndex->Remove((*found).second);
+		if (mIntervalIndex != NULL)
+			mIntervalIndex->Remove(static_cast<CICalendarComponentRecur*>((*found).second));
+		if (mInstanceCache != NULL)
+			mInstanceCache->Invalidate((*found).second->GetUID());
+		erase(found);
+	}
 	
 	// Delete if required
 	if (delete_it)
@@ -133,14 +176,25 @@ void CICalendarComponentDB::RemoveAllComponents()
 	{
 		// Tell component it is removed and delete it
 		(*iter).second->Removed();
+		if (mKeyIndex != NULL)
+			mKeyIndex->Remove((*iter).second);
+		if (mIntervalIndex != NULL)
+			mIntervalIndex->Remove(static_cast<CICalendarComponentRecur*>((*iter).second));
 		delete (*iter).second;
 	}
 	
 	clear();
+	mIndex.clear();
+	if (mInstanceCache != NULL)
+		mInstanceCache->clear();
 }
 
 void CICalendarComponentDB::ChangedComponent(CICalendarComponent* comp)
 {
+	// Expanded instances are out of date
+	if (mInstanceCache != NULL)
+		mInstanceCache->Invalidate(comp->GetUID());
+
 	// Tell component it is changed
 	comp->Changed();
 }
@@ -148,22 +202,22 @@ void CICalendarComponentDB::ChangedComponent(CICalendarComponent* comp)
 void CICalendarComponentDB::GetRecurrenceInstances(const cdstring& uid, CICalendarDateTimeList& ids) const
 {
 	// Look for matching UID in recurrence instance map
-	CICalendarRecurrenceMap::const_iterator found = mRecurMap.find(uid);
-	if (found != mRecurMap.end())
+	const CICalendarDateTimeList* found = mRecurMap.Find(uid.c_str());
+	if (found != NULL)
 	{
 		// Return the recurrence ids
-		ids = (*found).second;
+		ids = *found;
 	}
 }
 
 void CICalendarComponentDB::GetRecurrenceInstances(const cdstring& uid, CICalendarComponentRecurs& items) const
 {
 	// Look for matching UID in recurrence instance map
-	CICalendarRecurrenceMap::const_iterator found = mRecurMap.find(uid);
-	if (found != mRecurMap.end())
+	const CICalendarDateTimeList* found = mRecurMap.Find(uid.c_str());
+	if (found != NULL)
 	{
 		// Return all the recurrence ids
-		for(CICalendarDateTimeList::const_iterator iter = (*found).second.begin(); iter != (*found).second.end(); iter++)
+		for(CICalendarDateTimeList::const_iterator iter = found->begin(); iter != found->end(); iter++)
 		{
 			// Look it up
 			CICalendarComponentRecur* recur = GetRecurrenceInstance(uid, *iter);
@@ -184,3 +238,13 @@ CICalendarComponentRecur* CICalendarComponentDB::GetRecurrenceInstance(const cds
 	
 	return NULL;
 }
+
+void CICalendarComponentDB::_copy_CICalendarComponentDB(const CICalendarComponentDB& copy)
+{
+	mRecurMap = copy.mRecurMap;
+
+	// Index must point into this map
+	mIndex.clear();
+	for(iterator iter = begin(); iter != end(); iter++)
+		mIndex.Insert((*iter).first.c_str(), iter);
+}
@@ -30,6 +30,9 @@
 #include "cdstring.h"
 
 #include "CICalendarDateTime.h"
+#include "CICalendarHashTable.h"
+#include "CICalendarInstanceCache.h"
+#include "CICalendarIntervalIndex.h"
 
 
 namespace iCal {
@@ -43,26 +46,72 @@ typedef std::vector<CICalendarComponentRecur*> CICalendarComponentRecurs;
 typedef uint32_t	CICalendarRef;	// Unique reference to object
 class CICalendar;
 
+// Map key -> component across all the component DBs of a calendar. Keys shared by
+// components of different types are counted so the calendar can fall back to
+// searching each DB in turn.
+
+class CICalendarComponentKeyIndex
+{
+public:
+	CICalendarComponentKeyIndex()
+		{ mCollisions = 0; }
+	~CICalendarComponentKeyIndex() {}
+
+	void Add(CICalendarComponent* comp);
+	void Remove(const CICalendarComponent* comp);
+
+	CICalendarComponent* Find(const cdstring& mapkey) const
+		{ CICalendarComponent* const* found = mIndex.Find(mapkey.c_str()); return (found != NULL) ? *found : NULL; }
+
+	bool HasCollisions() const
+		{ return mCollisions != 0; }
+
+	void clear()
+		{ mIndex.clear(); mCollisions = 0; }
+
+private:
+	CICalendarHashTable<CICalendarComponent*>	mIndex;
+	uint32_t									mCollisions;
+
+	// Not copyable - owned by one calendar
+	CICalendarComponentKeyIndex(const CICalendarComponentKeyIndex& copy);
+	CICalendarComponentKeyIndex& operator=(const CICalendarComponentKeyIndex& copy);
+};
+
 class CICalendarComponentDB : public CICalendarComponentMap
 {
 public:
 	CICalendarComponentDB()
-		{ }
+		{ mKeyIndex = NULL; mIntervalIndex = NULL; mInstanceCache = NULL; }
 	CICalendarComponentDB(const CICalendarComponentDB& copy) :
 		CICalendarComponentMap(copy)
-		{ _copy_CICalendarComponentDB(copy); }
+		{ mKeyIndex = NULL; mIntervalIndex = NULL; mInstanceCache = NULL; _copy_CICalendarComponentDB(copy); }
 	virtual ~CICalendarComponentDB() {}
 
 	CICalendarComponentDB& operator=(const CICalendarComponentDB& copy)
 		{
 			if (this != &copy)
 			{
-				_copy_CICalendarComponentDB(copy);
 				CICalendarComponentMap::operator=(copy);
+				_copy_CICalendarComponentDB(copy);
 			}
 			return *this;
 		}
 
+	// Hash lookups rather than searching the map
+	iterator find(const cdstring& key)
+		{ iterator* found = mIndex.Find(key.c_str()); return (found != NULL) ? *found : end(); }
+	const_iterator find(const cdstring& key) const
+		{ const iterator* found = mIndex.Find(key.c_str()); return (found != NULL) ? const_iterator(*found) : end(); }
+
+	// Calendar-wide index kept up to date as components are added and removed
+	void SetKeyIndex(CICalendarComponentKeyIndex* index)
+		{ mKeyIndex = index; }
+	void SetIntervalIndex(CICalendarIntervalIndex* index)
+		{ mIntervalIndex = index; }
+	void SetInstanceCache(CICalendarInstanceCache* cache)
+		{ mInstanceCache = cache; }
+
 	bool AddComponent(CICalendarComponent* comp);
 	void RemoveComponent(CICalendarComponent* comp, bool delete_it);
 	void RemoveAllComponents();
@@ -72,15 +121,19 @@ public:
 	void GetRecurrenceInstances(const cdstring& uid, CICalendarComponentRecurs& items) const;
 
 protected:
-	typedef std::map<cdstring, CICalendarDateTimeList> CICalendarRecurrenceMap;
+	typedef CICalendarHashTable<iterator> CICalendarComponentIndex;
+	typedef CICalendarHashTable<CICalendarDateTimeList> CICalendarRecurrenceMap;
 
-	CICalendarRecurrenceMap	mRecurMap;
+	CICalendarComponentIndex	mIndex;			// Map key -> item in the map
+	CICalendarRecurrenceMap		mRecurMap;
+	CICalendarComponentKeyIndex*	mKeyIndex;		// Not owned
+	CICalendarIntervalIndex*		mIntervalIndex;	// Not owned
+	CICalendarInstanceCache*		mInstanceCache;	// Not owned
 
 	CICalendarComponentRecur* GetRecurrenceInstance(const cdstring& uid, const CICalendarDateTime& rid) const;
 
 private:
-	void	_copy_CICalendarComponentDB(const CICalendarComponentDB& copy)
-		{ mRecurMap = copy.mRecurMap; }
+	void	_copy_CICalendarComponentDB(const CICalendarComponentDB& copy);
 };
 
 typedef std::vector<const CICalendarComponentDB*> CICalendarComponentDBList;
@@ -26,7 +26,6 @@
 #include "CICalendarComponentExpanded.h"
 
 #include "CICalendarComponentRecur.h"
-#include "CICalendarDuration.h"
 
 using namespace iCal;
 
@@ -66,62 +65,7 @@ bool CICalendarComponentExpanded::sort_by_dtstart(const CICalendarComponentExpan
 
 void CICalendarComponentExpanded::InitFromOwner(const CICalendarDateTime* rid)
 {
-	// There are four possibilities here:
-	//
-	// 1: this instance is the instance for the master component
-	//
-	// 2: this instance is an expanded instance derived directly from the master component
-	//
-	// 3: This instance is the instance for a slave (overridden recurrence instance)
-	//
-	// 4: This instance is the expanded instance for a slave with a RANGE parameter
-	//
-
-	// rid is not set if the owner is the master (case 1)
-	if (rid == NULL)
-	{
-		// Just get start/end from owner
-		mInstanceStart = mOwner->GetStart();
-		mInstanceEnd = mOwner->GetEnd();
-		mRecurring = false;
-	}
-
-	// If the owner is not a recurrence instance then it is case 2
-	else if (!mOwner->IsRecurrenceInstance())
-	{
-		// Derive start/end from rid and duration of master
-
-		// Start of the recurrence instance is the recurrence id
-		mInstanceStart = *rid;
-		
-		// End is based on original events settings
-		mInstanceEnd = mInstanceStart + (mOwner->GetEnd() - mOwner->GetStart());
-		
-		mRecurring = true;
-	}
-		
-	// If the owner is a recurrence item and the passed in rid is the same as the component rid we have case 3
-	else if (*rid == mOwner->GetRecurrenceID())
-	{
-		// Derive start/end directly from the owner
-		mInstanceStart = mOwner->GetStart();
-		mInstanceEnd = mOwner->GetEnd();
-		
-		mRecurring = true;
-	}
-	
-	// case 4 - the complicated one!
-	else
-	{
-		// We need to use the rid as the starting point, but adjust it by the offset between the slave's
-		// rid and its start
-		mInstanceStart = *rid + (mOwner->GetStart() - mOwner->GetRecurrenceID());
-		
-		// End is based on duration of owner
-		mInstanceEnd = mInstanceStart + (mOwner->GetEnd() - mOwner->GetStart());
-		
-		mRecurring = true;
-	}
+	mRecurring = CICalendarInstance::InstanceTimes(mOwner, rid, mInstanceStart, mInstanceEnd);
 }
 
 bool CICalendarComponentExpanded::IsNow() const
@@ -30,6 +30,7 @@
 
 #include "CICalendarDateTime.h"
 #include "CICalendarComponentRecur.h"
+#include "CICalendarInstance.h"
 
 namespace iCal {
 
@@ -49,6 +50,13 @@ public:
 		mOwner = owner;
 		InitFromOwner(rid);
 	}
+	explicit CICalendarComponentExpanded(const CICalendarInstance& instance)
+	{
+		mOwner = instance.GetOwner();
+		mInstanceStart = instance.GetInstanceStart();
+		mInstanceEnd = instance.GetInstanceEnd();
+		mRecurring = instance.Recurring();
+	}
 	CICalendarComponentExpanded(const CICalendarComponentExpanded& copy)
 	{
 		_copy_CICalendarComponentExpanded(copy);
@@ -174,11 +174,11 @@ void CICalendarComponentRecur::Finalise()
 		
 		// Also get the RANGE attribute
 		const CICalendarAttributeMap& attrs = (*GetProperties().find(cICalProperty_RECURRENCE_ID)).second.GetAttributes();
-		CICalendarAttributeMap::const_iterator found = attrs.find(cICalAttribute_RANGE);
+		CICalendarAttributeMap::const_iterator found = attrs.find(CICalendarAttribute::eRANGE);
 		if (found != attrs.end())
 		{
-			mAdjustFuture = ((*found).second.GetFirstValue() == cICalAttribute_RANGE_THISANDFUTURE);
-			mAdjustPrior = ((*found).second.GetFirstValue() == cICalAttribute_RANGE_THISANDPRIOR);
+			mAdjustFuture = ((*found).GetFirstValue() == cICalAttribute_RANGE_THISANDFUTURE);
+			mAdjustPrior = ((*found).GetFirstValue() == cICalAttribute_RANGE_THISANDPRIOR);
 		}
 		else
 		{
@@ -341,7 +341,19 @@ void CICalendarComponentRecur::InitFromMaster()
 	}
 }
 
+// Shared items for each instance
 void CICalendarComponentRecur::ExpandPeriod(const CICalendarPeriod& period, CICalendarExpandedComponents& list)
+{
+	CICalendarInstanceList instances;
+	ExpandPeriod(period, instances);
+
+	list.reserve(list.size() + instances.size());
+	for(CICalendarInstanceList::const_iterator iter = instances.begin(); iter != instances.end(); iter++)
+		list.push_back(CICalendarComponentExpandedShared(new CICalendarComponentExpanded(*iter)));
+}
+
+// rids gets the recurrence id of each expanded recurrence of a master
+void CICalendarComponentRecur::ExpandPeriod(const CICalendarPeriod& period, CICalendarInstanceList& list, CICalendarDateTimeList* rids)
 {
 	// Check for recurrence and true master
 	if ((mRecurrences != NULL) && mRecurrences->HasRecurrence() && !IsRecurrenceInstance())
@@ -385,7 +397,9 @@ void CICalendarComponentRecur::ExpandPeriod(const CICalendarPeriod& period, CICa
 					// Add each expanded item
 					for(CICalendarDateTimeList::const_iterator iter = items.begin(); iter != items.end(); iter++)
 					{
-						list.push_back(CreateExpanded(this, *iter));
+						list.push_back(CICalendarInstance(this, &(*iter)));
+						if (rids != NULL)
+							rids->push_back(*iter);
 					}
 				}
 				else
@@ -420,7 +434,9 @@ void CICalendarComponentRecur::ExpandPeriod(const CICalendarPeriod& period, CICa
 							}
 						}
 						
-						list.push_back(CreateExpanded(slave != NULL ? slave : this, *iter1));
+						list.push_back(CICalendarInstance(slave != NULL ? slave : this, &(*iter1)));
+						if (rids != NULL)
+							rids->push_back(*iter1);
 					}
 				}
 			}
@@ -429,25 +445,23 @@ void CICalendarComponentRecur::ExpandPeriod(const CICalendarPeriod& period, CICa
 				// Add each expanded item
 				for(CICalendarDateTimeList::const_iterator iter = items.begin(); iter != items.end(); iter++)
 				{
-					list.push_back(CreateExpanded(this, *iter));
+					list.push_back(CICalendarInstance(this, &(*iter)));
+					if (rids != NULL)
+						rids->push_back(*iter);
 				}
 			}
 		}
 	}
 	
 	else if (WithinPeriod(period))
-		list.push_back(CICalendarComponentExpandedShared(new CICalendarComponentExpanded(this, IsRecurrenceInstance() ? &mRecurrenceID : NULL)));
+		list.push_back(CICalendarInstance(this, IsRecurrenceInstance() ? &mRecurrenceID : NULL));
 }
 
 bool CICalendarComponentRecur::WithinPeriod(const CICalendarPeriod& period) const
 {
 	// Check for recurrence
 	if ((mRecurrences != NULL) && mRecurrences->HasRecurrence())
-	{
-		CICalendarDateTimeList items;
-		mRecurrences->Expand(mStart, period, items);
-		return !items.empty();
-	}
+		return mRecurrences->WithinPeriod(mStart, period);
 	else
 	{
 		// Does event span the period (assume mEnd > mStart)
@@ -459,11 +473,6 @@ bool CICalendarComponentRecur::WithinPeriod(const CICalendarPeriod& period) cons
 	}
 }
 
-CICalendarComponentExpandedShared CICalendarComponentRecur::CreateExpanded(CICalendarComponentRecur* master, const CICalendarDateTime& recurid)
-{
-	return CICalendarComponentExpandedShared(new CICalendarComponentExpanded(master, &recurid));
-}
-
 bool CICalendarComponentRecur::IsRecurring() const
 {
 	return (mRecurrences != NULL) && mRecurrences->HasRecurrence();
@@ -475,6 +484,11 @@ void CICalendarComponentRecur::ChangedRecurrence()
 	// Clear cached values
 	if (mRecurrences != NULL)
 		mRecurrences->Changed();
+
+	// Including any expanded instances held by the calendar
+	CICalendar* cal = CICalendar::GetICalendar(GetCalendar());
+	if (cal != NULL)
+		cal->ChangedRecurrence(this);
 }
 
 void CICalendarComponentRecur::EditSummary(const cdstring& summary)
@@ -27,6 +27,7 @@
 #include "CICalendarComponent.h"
 
 #include "CICalendarDateTime.h"
+#include "CICalendarInstance.h"
 
 #include "cdsharedptr.h"
 #include "ptrvector.h"
@@ -158,6 +159,9 @@ public:
 	virtual void Finalise();
 
 			void ExpandPeriod(const CICalendarPeriod& period, CICalendarExpandedComponents& list);
+			void ExpandPeriod(const CICalendarPeriod& period, CICalendarInstanceList& list)
+				{ ExpandPeriod(period, list, NULL); }
+			void ExpandPeriod(const CICalendarPeriod& period, CICalendarInstanceList& list, CICalendarDateTimeList* rids);
 
 			bool WithinPeriod(const CICalendarPeriod& period) const;
 
@@ -209,8 +213,6 @@ protected:
 
 			void	InitFromMaster();
 
-	CICalendarComponentExpandedShared	CreateExpanded(CICalendarComponentRecur* master, const CICalendarDateTime& recurid);
-
 private:
 	void	_copy_CICalendarComponentRecur(const CICalendarComponentRecur& copy);
 	void	_tidy_CICalendarComponentRecur();
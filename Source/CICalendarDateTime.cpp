@@ -27,7 +27,9 @@
 #include "CICalendarDuration.h"
 #include "CICalendarLocale.h"
 #include "CICalendarManager.h"
+#include "CICalendarMutex.h"
 #include "CICalendarUtils.h"
+#include "CICalendarVTimezone.h"
 
 #include <ctime>
 #include <iomanip>
@@ -36,6 +38,18 @@
 
 using namespace iCal;
 
+// Floating times resolve via the default timezone - both counters start at 1 so this is never 0
+static uint32_t floating_epoch()
+{
+	return CICalendarManager::GetDefaultTimezoneGeneration() + CICalendarVTimezone::GetGeneration();
+}
+
+// Day number of a sort key rounding towards the past
+static int64_t sort_key_day(int64_t key)
+{
+	return (key >= 0) ? key / 86400 : (key - 86399) / 86400;
+}
+
 CICalendarDateTime::CICalendarDateTime(int32_t packed, const CICalendarTimezone* tzid)
 {
 	_init_CICalendarDateTime();
@@ -66,8 +80,10 @@ void CICalendarDateTime::_init_CICalendarDateTime()
 
 	mDateOnly = false;
 
-	mPosixTime.first = false;
-	mPosixTime.second = 0;
+	mPosixTime = 0;
+	mPosixState = 0;
+	mSortKey = 0;
+	mSortKeyState = eSortKeyUnknown;
 }
 
 void CICalendarDateTime::_copy_CICalendarDateTime(const CICalendarDateTime& copy)
@@ -84,7 +100,11 @@ void CICalendarDateTime::_copy_CICalendarDateTime(const CICalendarDateTime& copy
 
 	mTimezone = copy.mTimezone;
 
-	mPosixTime = copy.mPosixTime;
+	// Caches may be filled in by another thread so get their state first
+	mPosixState = CICalendarMutex::LoadAcquire(copy.mPosixState);
+	mPosixTime = (mPosixState != 0) ? copy.mPosixTime : 0;
+	mSortKeyState = CICalendarMutex::LoadAcquire(copy.mSortKeyState);
+	mSortKey = (mSortKeyState == eSortKeyValid) ? copy.mSortKey : 0;
 }
 
 CICalendarDateTime CICalendarDateTime::operator+(const CICalendarDuration& duration) const
@@ -381,58 +401,23 @@ const cdstring& CICalendarDateTime::GetDayOfWeekText(EDayOfWeek day) const
 int CICalendarDateTime::CompareDateTime(const CICalendarDateTime& comp) const
 {
 	// If either are date only, then just do date compare
-	if (mDateOnly || comp.mDateOnly)
-	{
-		if (mYear == comp.mYear)
-		{
-			if (mMonth == comp.mMonth)
-			{
-				if (mDay == comp.mDay)
-					return 0;
-				else
-					return mDay < comp.mDay ? -1 : 1;
-			}
-			else
-				return mMonth < comp.mMonth ? -1 : 1;
-		}
-		else
-			return mYear < comp.mYear ? -1 : 1;
-	}
-	
+	bool date_only = mDateOnly || comp.mDateOnly;
+
 	// If they have the same timezone do simple compare - no posix calc needed
-	else if (GetTimezone() == comp.GetTimezone())
+	if (date_only || (GetTimezone() == comp.GetTimezone()))
 	{
-		if (mYear == comp.mYear)
+		// Wall-clock sort keys give the same ordering as the fields when those are in range
+		if (HasSortKey() && comp.HasSortKey())
 		{
-			if (mMonth == comp.mMonth)
-			{
-				if (mDay == comp.mDay)
-				{
-					if (mHours == comp.mHours)
-					{
-						if (mMinutes == comp.mMinutes)
-						{
-							if (mSeconds == comp.mSeconds)
-							{
-								return 0;
-							}
-							else
-								return mSeconds < comp.mSeconds ? -1 : 1;
-						}
-						else
-							return mMinutes < comp.mMinutes ? -1 : 1;
-					}
-					else
-						return mHours < comp.mHours ? -1 : 1;
-				}
-				else
-					return mDay < comp.mDay ? -1 : 1;
-			}
+			int64_t key1 = date_only ? sort_key_day(mSortKey) : mSortKey;
+			int64_t key2 = date_only ? sort_key_day(comp.mSortKey) : comp.mSortKey;
+			if (key1 == key2)
+				return 0;
 			else
-				return mMonth < comp.mMonth ? -1 : 1;
+				return key1 < key2 ? -1 : 1;
 		}
 		else
-			return mYear < comp.mYear ? -1 : 1;
+			return CompareFields(comp, date_only);
 	}
 	else
 	{
@@ -445,28 +430,79 @@ int CICalendarDateTime::CompareDateTime(const CICalendarDateTime& comp) const
 	}
 }
 
-int64_t CICalendarDateTime::GetPosixTime() const
+// Cache the wall-clock sort key if the fields are in range
+bool CICalendarDateTime::HasSortKey() const
 {
-	// Look for cached value (or floating time which has to be calculated each time)
-	if (!mPosixTime.first || GetTimezone().Floating())
+	ESortKeyState state = CICalendarMutex::LoadAcquire(mSortKeyState);
+	if (state == eSortKeyUnknown)
 	{
-		int64_t result = 0;
+		if ((mMonth >= 1) && (mMonth <= 12) &&
+			(mDay >= 1) && (mDay <= CICalendarUtils::DaysInMonth(mMonth, mYear)) &&
+			(mHours >= 0) && (mHours <= 23) &&
+			(mMinutes >= 0) && (mMinutes <= 59) &&
+			(mSeconds >= 0) && (mSeconds <= 59))
+		{
+			mSortKey = GetFloatingPosixTime();
+			state = eSortKeyValid;
+		}
+		else
+			state = eSortKeyInvalid;
+		CICalendarMutex::StoreRelease(mSortKeyState, state);
+	}
+
+	return state == eSortKeyValid;
+}
 
-		// Add hour/mins/secs
-		result = (mHours * 60LL + mMinutes) * 60LL + mSeconds;
+int CICalendarDateTime::CompareFields(const CICalendarDateTime& comp, bool date_only) const
+{
+	if (mYear != comp.mYear)
+		return mYear < comp.mYear ? -1 : 1;
+	else if (mMonth != comp.mMonth)
+		return mMonth < comp.mMonth ? -1 : 1;
+	else if (mDay != comp.mDay)
+		return mDay < comp.mDay ? -1 : 1;
+	else if (date_only)
+		return 0;
+	else if (mHours != comp.mHours)
+		return mHours < comp.mHours ? -1 : 1;
+	else if (mMinutes != comp.mMinutes)
+		return mMinutes < comp.mMinutes ? -1 : 1;
+	else if (mSeconds != comp.mSeconds)
+		return mSeconds < comp.mSeconds ? -1 : 1;
+	else
+		return 0;
+}
 
-		// Number of days since 1970
-		result += DaysSince1970() * 24LL * 60LL * 60LL;
+int64_t CICalendarDateTime::GetPosixTime() const
+{
+	// Look for cached value (floating time is only cached until the default timezone or timezone set changes)
+	uint32_t state = (GetTimezone().Floating() ? floating_epoch() : 0) + 1;
+	if (CICalendarMutex::LoadAcquire(mPosixState) != state)
+	{
+		int64_t result = GetFloatingPosixTime();
 
 		// Adjust for timezone offset
 		result -= TimeZoneSecondsOffset();
 
 		// Now indcate cache state
-		mPosixTime.first = true;
-		mPosixTime.second = result;
+		mPosixTime = result;
+		CICalendarMutex::StoreRelease(mPosixState, state);
+		return result;
 	}
 
-	return mPosixTime.second;
+	return mPosixTime;
+}
+
+// Posix time of the wall-clock value (i.e. ignoring the timezone)
+int64_t CICalendarDateTime::GetFloatingPosixTime() const
+{
+	// Add hour/mins/secs
+	int64_t result = (mHours * 60LL + mMinutes) * 60LL + mSeconds;
+
+	// Number of days since 1970
+	result += DaysSince1970() * 24LL * 60LL * 60LL;
+
+	return result;
 }
 
 int32_t	CICalendarDateTime::DaysSince1970() const
@@ -812,50 +848,34 @@ cdstring CICalendarDateTime::GetText() const
 }
 
 void CICalendarDateTime::Parse(const cdstring& data)
+{
+	Parse(data.c_str(), data.length());
+}
+
+void CICalendarDateTime::Parse(const char* data, size_t length)
 {
 	// parse format YYYYMMDD[THHMMSS[Z]]
 
 	// Size must be at least 8
-	if (data.length() < 8)
+	if (length < 8)
 		return;
 
-	// Get year
-	char buf[256];
-	::strncpy(buf, data.c_str(), 4);
-	buf[4] = 0;
-	mYear = strtol(buf, NULL, 10);
-
-	// Get month
-	::strncpy(buf, data.c_str() + 4, 2);
-	buf[2] = 0;
-	mMonth = strtol(buf, NULL, 10);
-
-	// Get day
-	::strncpy(buf, data.c_str() + 6, 2);
-	buf[2] = 0;
-	mDay = strtol(buf, NULL, 10);
+	// Get year, month, day
+	mYear = CICalendarUtils::ParseFixedNumber(data, 4);
+	mMonth = CICalendarUtils::ParseFixedNumber(data + 4, 2);
+	mDay = CICalendarUtils::ParseFixedNumber(data + 6, 2);
 
 	// Now look for more
-	if ((data.length() >= 15) && (data[(cdstring::size_type)8] == 'T'))
+	if ((length >= 15) && (data[8] == 'T'))
 	{
-		// Get hours
-		::strncpy(buf, data.c_str() + 9, 2);
-		buf[2] = 0;
-		mHours = strtol(buf, NULL, 10);
-
-		// Get minutes
-		::strncpy(buf, data.c_str() + 11, 2);
-		buf[2] = 0;
-		mMinutes = strtol(buf, NULL, 10);
-
-		// Get seconds
-		::strncpy(buf, data.c_str() + 13, 2);
-		buf[2] = 0;
-		mSeconds = strtol(buf, NULL, 10);
+		// Get hours, minutes, seconds
+		mHours = CICalendarUtils::ParseFixedNumber(data + 9, 2);
+		mMinutes = CICalendarUtils::ParseFixedNumber(data + 11, 2);
+		mSeconds = CICalendarUtils::ParseFixedNumber(data + 13, 2);
 
 		mDateOnly = false;
 
-		mTimezone.SetUTC(data[(cdstring::size_type)15] == 'Z');
+		mTimezone.SetUTC((length > 15) && (data[15] == 'Z'));
 	}
 	else
 		mDateOnly = true;
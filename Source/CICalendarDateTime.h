@@ -98,6 +98,7 @@ public:
 	bool CompareDate(const CICalendarDateTime& comp) const
 		{ return (mYear == comp.mYear) && (mMonth == comp.mMonth) && (mDay == comp.mDay); }
 	int64_t GetPosixTime() const;
+	int64_t GetFloatingPosixTime() const;
 
 	bool IsDateOnly() const
 		{ return mDateOnly; }
@@ -197,10 +198,18 @@ public:
 	cdstring GetText() const;
 
 	void Parse(const cdstring& data);
+	void Parse(const char* data, size_t length);
 	void Generate(std::ostream& os) const;
 	void GenerateRFC2822(std::ostream& os) const;
 
 protected:
+	enum ESortKeyState
+	{
+		eSortKeyUnknown,
+		eSortKeyValid,
+		eSortKeyInvalid		// fields out of range so must compare field by field
+	};
+
 	int32_t			mYear;		// full 4-digit year
 	int32_t			mMonth;		// 1...12
 	int32_t			mDay;		// 1...31
@@ -213,7 +222,11 @@ protected:
 
 	CICalendarTimezone	mTimezone;
 
-	mutable std::pair<bool, int64_t>	mPosixTime;
+	// Caches are published by their state so concurrent readers see complete values
+	mutable int64_t						mPosixTime;
+	mutable uint32_t					mPosixState;	// 0 if not cached, else epoch + 1 (floating time cache is only valid for the same epoch)
+	mutable int64_t						mSortKey;		// wall-clock seconds
+	mutable ESortKeyState				mSortKeyState;
 
 	void		Normalise();
 
@@ -227,7 +240,10 @@ private:
 	void _copy_CICalendarDateTime(const CICalendarDateTime& copy);
 
 	void Changed() const
-		{ mPosixTime.first = false; }
+		{ mPosixState = 0; mSortKeyState = eSortKeyUnknown; }
+
+	bool HasSortKey() const;
+	int CompareFields(const CICalendarDateTime& comp, bool date_only) const;
 	
 	int32_t	DaysSince1970() const;
 };
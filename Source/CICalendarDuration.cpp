@@ -23,8 +23,7 @@
 
 #include "CICalendarDuration.h"
 
-#include <cerrno>
-#include <cstdlib>
+#include "CICalendarUtils.h"
 
 using namespace iCal;
 
@@ -95,10 +94,15 @@ void CICalendarDuration::SetDuration(const int64_t seconds)
 }
 
 void CICalendarDuration::Parse(const cdstring& data)
+{
+	Parse(data.c_str());
+}
+
+void CICalendarDuration::Parse(const char* data)
 {
 	// parse format ([+]/-) "P" (dur-date / dur-time / dur-week)
 
-	const char* p = data.c_str();
+	const char* p = data;
 
 	// Look for +/-
 	mForward = true;
@@ -120,8 +124,8 @@ void CICalendarDuration::Parse(const cdstring& data)
 	if (*p != 'T')
 	{
 		// Must have a number
-		uint32_t num = strtoul(p, const_cast<char**>(&p), 10);
-		if ((errno == EINVAL) || (errno == ERANGE))
+		uint32_t num = 0;
+		if (!CICalendarUtils::ParseNumber(p, num))
 			return;
 
 		// Now look at character
@@ -151,8 +155,8 @@ void CICalendarDuration::Parse(const cdstring& data)
 
 	// Have time
 	p++;
-	uint32_t num = strtoul(p, const_cast<char**>(&p), 10);
-	if ((errno == EINVAL) || (errno == ERANGE))
+	uint32_t num = 0;
+	if (!CICalendarUtils::ParseNumber(p, num))
 		return;
 
 	// Look for hour
@@ -167,8 +171,7 @@ void CICalendarDuration::Parse(const cdstring& data)
 			return;
 
 		// Parse the next number
-		num = strtoul(p, const_cast<char**>(&p), 10);
-		if ((errno == EINVAL) || (errno == ERANGE))
+		if (!CICalendarUtils::ParseNumber(p, num))
 			return;
 	}
 
@@ -184,8 +187,7 @@ void CICalendarDuration::Parse(const cdstring& data)
 			return;
 
 		// Parse the next number
-		num = strtoul(p, const_cast<char**>(&p), 10);
-		if ((errno == EINVAL) || (errno == ERANGE))
+		if (!CICalendarUtils::ParseNumber(p, num))
 			return;
 	}
 
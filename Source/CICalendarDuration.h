@@ -64,6 +64,7 @@ public:
 		{ return mSeconds; }
 
 	void Parse(const cdstring& data);
+	void Parse(const char* data);
 	void Generate(std::ostream& os) const;
 
 protected:
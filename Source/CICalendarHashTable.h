@@ -0,0 +1,181 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+
+/*
+	CICalendarHashTable.h
+
+	Author:
+	Description:	open addressing hash table with string keys
+*/
+
+#ifndef CICalendarHashTable_H
+#define CICalendarHashTable_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cstring>
+#include <vector>
+
+#include "cdstring.h"
+
+namespace iCal {
+
+// Linear probing with backward shift deletion, so there are no tombstones. Each slot keeps
+// the hash of its key so that probes only compare strings when the hashes match.
+
+template <class T> class CICalendarHashTable
+{
+public:
+	CICalendarHashTable()
+		{ mSize = 0; }
+
+	static uint32_t Hash(const char* key)
+	{
+		// FNV-1a
+		uint32_t hash = 2166136261UL;
+		for(const unsigned char* p = reinterpret_cast<const unsigned char*>(key); *p != 0; p++)
+		{
+			hash ^= *p;
+			hash *= 16777619UL;
+		}
+		return hash;
+	}
+
+	size_t size() const
+		{ return mSize; }
+	bool empty() const
+		{ return mSize == 0; }
+	void clear()
+		{ mSlots.clear(); mSize = 0; }
+
+	// NULL if not present
+	T* Find(const char* key)
+		{ return Find(key, Hash(key)); }
+	const T* Find(const char* key) const
+		{ return Find(key, Hash(key)); }
+	T* Find(const char* key, uint32_t hash)
+	{
+		size_t index;
+		return Lookup(key, hash, index) ? &mSlots[index].mValue : NULL;
+	}
+	const T* Find(const char* key, uint32_t hash) const
+	{
+		size_t index;
+		return Lookup(key, hash, index) ? &mSlots[index].mValue : NULL;
+	}
+
+	// Existing value is left alone if the key is already present
+	T& Insert(const char* key, const T& value)
+	{
+		uint32_t hash = Hash(key);
+		size_t index;
+		if (Lookup(key, hash, index))
+			return mSlots[index].mValue;
+
+		// Keep the load below 3/4
+		if ((mSize + 1) * 4 > mSlots.size() * 3)
+		{
+			Grow();
+			Lookup(key, hash, index);
+		}
+
+		SSlot& slot = mSlots[index];
+		slot.mUsed = true;
+		slot.mHash = hash;
+		slot.mKey = key;
+		slot.mValue = value;
+		mSize++;
+		return slot.mValue;
+	}
+
+	bool Remove(const char* key)
+	{
+		size_t index;
+		if (!Lookup(key, Hash(key), index))
+			return false;
+
+		// Move back any following items that would no longer be found
+		size_t mask = mSlots.size() - 1;
+		size_t hole = index;
+		for(size_t next = (hole + 1) & mask; mSlots[next].mUsed; next = (next + 1) & mask)
+		{
+			size_t home = mSlots[next].mHash & mask;
+			if (((next - home) & mask) >= ((next - hole) & mask))
+			{
+				mSlots[hole] = mSlots[next];
+				hole = next;
+			}
+		}
+
+		mSlots[hole] = SSlot();
+		mSize--;
+		return true;
+	}
+
+private:
+	struct SSlot
+	{
+		bool		mUsed;
+		uint32_t	mHash;
+		cdstring	mKey;
+		T			mValue;
+
+		SSlot()
+			: mUsed(false), mHash(0), mValue() {}
+	};
+
+	std::vector<SSlot>	mSlots;				// Size is zero or a power of two
+	size_t				mSize;
+
+	// Index of the key if found, otherwise the empty slot where it would go
+	bool Lookup(const char* key, uint32_t hash, size_t& index) const
+	{
+		if (mSlots.empty())
+			return false;
+
+		size_t mask = mSlots.size() - 1;
+		for(index = hash & mask; mSlots[index].mUsed; index = (index + 1) & mask)
+		{
+			if ((mSlots[index].mHash == hash) && (::strcmp(mSlots[index].mKey.c_str(), key) == 0))
+				return true;
+		}
+		return false;
+	}
+
+	void Grow()
+	{
+		std::vector<SSlot> old;
+		old.swap(mSlots);
+		mSlots.resize(old.empty() ? 16 : old.size() * 2);
+
+		// Cached hashes mean keys never need hashing again
+		size_t mask = mSlots.size() - 1;
+		for(typename std::vector<SSlot>::const_iterator iter = old.begin(); iter != old.end(); iter++)
+		{
+			if (!(*iter).mUsed)
+				continue;
+			size_t index = (*iter).mHash & mask;
+			while(mSlots[index].mUsed)
+				index = (index + 1) & mask;
+			mSlots[index] = *iter;
+		}
+	}
+};
+
+}	// namespace iCal
+
+#endif	// CICalendarHashTable_H
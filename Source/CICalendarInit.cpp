@@ -7,8 +7,10 @@
 
 #include "CICalendar.h"
 
+#include "CICalendarArena.h"
 #include "CICalendarComponent.h"
 #include "CICalendarProperty.h"
+#include "CICalendarVTimezone.h"
 
 using namespace iCal;
 
@@ -20,3 +22,7 @@ CICalendarProperty::CMultiValues CICalendarProperty::sMultiValues;
 CICalendar::CICalendarRefMap CICalendar::sICalendars;
 //CICalendar CICalendar::sICalendar;
 CICalendarRef CICalendar::sICalendarRefCtr = 1;
+
+uint32_t CICalendarVTimezone::sGeneration = 1;
+
+CICALENDAR_THREAD_LOCAL CICalendarArena* CICalendarArena::sCurrent = NULL;
@@ -0,0 +1,141 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+
+/*
+	CICalendarInstance.cpp
+
+	Author:
+	Description:	plain value for one expanded instance of a component
+*/
+
+#include "CICalendarInstance.h"
+
+#include "CICalendarComponentRecur.h"
+#include "CICalendarDuration.h"
+
+using namespace iCal;
+
+// Same ordering as CICalendarComponentExpanded::sort_by_dtstart_allday
+bool CICalendarInstance::sort_by_dtstart_allday(const CICalendarInstance& e1, const CICalendarInstance& e2)
+{
+	if (e1.IsDateOnly() && e2.IsDateOnly())
+		return e1.mInstanceStart.CompareDateTime(e2.mInstanceStart) < 0;
+	else if (e1.IsDateOnly())
+		return true;
+	else if (e2.IsDateOnly())
+		return false;
+
+	int result = e1.mInstanceStart.CompareDateTime(e2.mInstanceStart);
+	if (result == 0)
+	{
+		result = e1.mInstanceEnd.CompareDateTime(e2.mInstanceEnd);
+		if (result == 0)
+			// Put ones created earlier in earlier columns in day view
+			return e1.mOwner->GetStamp() < e2.mOwner->GetStamp();
+		else
+			// Put ones that end later in earlier columns in day view
+			return result > 0;
+	}
+	else
+		return result < 0;
+}
+
+// Same ordering as CICalendarComponentExpanded::sort_by_dtstart
+bool CICalendarInstance::sort_by_dtstart(const CICalendarInstance& e1, const CICalendarInstance& e2)
+{
+	int result = e1.mInstanceStart.CompareDateTime(e2.mInstanceStart);
+	if (result == 0)
+	{
+		if (e1.IsDateOnly() ^ e2.IsDateOnly())
+			return e1.IsDateOnly();
+		else
+			return false;
+	}
+	else
+		return result < 0;
+}
+
+bool CICalendarInstance::InstanceTimes(const CICalendarComponentRecur* owner, const CICalendarDateTime* rid, CICalendarDateTime& start, CICalendarDateTime& end)
+{
+	// There are four possibilities here:
+	//
+	// 1: this instance is the instance for the master component
+	//
+	// 2: this instance is an expanded instance derived directly from the master component
+	//
+	// 3: This instance is the instance for a slave (overridden recurrence instance)
+	//
+	// 4: This instance is the expanded instance for a slave with a RANGE parameter
+	//
+
+	// rid is not set if the owner is the master (case 1)
+	if (rid == NULL)
+	{
+		// Just get start/end from owner
+		start = owner->GetStart();
+		end = owner->GetEnd();
+		return false;
+	}
+
+	// If the owner is not a recurrence instance then it is case 2
+	else if (!owner->IsRecurrenceInstance())
+	{
+		// Derive start/end from rid and duration of master
+
+		// Start of the recurrence instance is the recurrence id
+		start = *rid;
+		
+		// End is based on original events settings
+		end = start + (owner->GetEnd() - owner->GetStart());
+		
+		return true;
+	}
+		
+	// If the owner is a recurrence item and the passed in rid is the same as the component rid we have case 3
+	else if (*rid == owner->GetRecurrenceID())
+	{
+		// Derive start/end directly from the owner
+		start = owner->GetStart();
+		end = owner->GetEnd();
+		
+		return true;
+	}
+	
+	// case 4 - the complicated one!
+	else
+	{
+		// We need to use the rid as the starting point, but adjust it by the offset between the slave's
+		// rid and its start
+		start = *rid + (owner->GetStart() - owner->GetRecurrenceID());
+		
+		// End is based on duration of owner
+		end = start + (owner->GetEnd() - owner->GetStart());
+		
+		return true;
+	}
+}
+
+CICalendarInstance::CICalendarInstance(CICalendarComponentRecur* owner, const CICalendarDateTime* rid)
+{
+	mOwner = owner;
+
+	CICalendarDateTime start;
+	CICalendarDateTime end;
+	mRecurring = InstanceTimes(owner, rid, start, end);
+	mInstanceStart = CICalendarPackedDateTime(start);
+	mInstanceEnd = CICalendarPackedDateTime(end);
+}
@@ -0,0 +1,90 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+
+/*
+	CICalendarInstance.h
+
+	Author:
+	Description:	plain value for one expanded instance of a component
+*/
+
+#ifndef CICalendarInstance_H
+#define CICalendarInstance_H
+
+#include "CICalendarDateTime.h"
+#include "CICalendarPackedDateTime.h"
+
+#include <vector>
+
+namespace iCal {
+
+class CICalendarComponentRecur;
+
+// Same information as CICalendarComponentExpanded without a heap object per instance, so a
+// whole expansion is one contiguous vector. The start and end are packed and converted back
+// to date-times on request.
+
+class CICalendarInstance
+{
+public:
+	static bool sort_by_dtstart_allday(const CICalendarInstance& e1, const CICalendarInstance& e2);
+	static bool sort_by_dtstart(const CICalendarInstance& e1, const CICalendarInstance& e2);
+
+	// Start and end of the instance of owner with rid - returns true if it is a recurrence
+	static bool InstanceTimes(const CICalendarComponentRecur* owner, const CICalendarDateTime* rid, CICalendarDateTime& start, CICalendarDateTime& end);
+
+	CICalendarInstance()
+		{ mOwner = NULL; mRecurring = false; }
+	CICalendarInstance(CICalendarComponentRecur* owner, const CICalendarDateTime* rid);
+
+	CICalendarComponentRecur* GetOwner() const
+	{
+		return mOwner;
+	}
+
+	template<class T> T* GetMaster() const
+	{
+		return static_cast<T*>(mOwner);
+	}
+
+	CICalendarDateTime GetInstanceStart() const
+		{ return mInstanceStart.GetDateTime(); }
+	CICalendarDateTime GetInstanceEnd() const
+		{ return mInstanceEnd.GetDateTime(); }
+
+	bool IsDateOnly() const
+		{ return mInstanceStart.IsDateOnly(); }
+
+	bool Recurring() const
+	{
+		return mRecurring;
+	}
+
+private:
+	CICalendarComponentRecur*	mOwner;
+
+	CICalendarPackedDateTime	mInstanceStart;
+	CICalendarPackedDateTime	mInstanceEnd;
+
+	bool						mRecurring;
+};
+
+typedef std::vector<CICalendarInstance> CICalendarInstanceList;
+
+}	// namespace iCal
+
+#endif	// CICalendarInstance_H
@@ -0,0 +1,203 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+	CICalendarInstanceCache.cpp
+
+	Author:
+	Description:	expanded instances of recurring components cached by week
+*/
+
+#include "CICalendarInstanceCache.h"
+
+#include "CICalendarComponentRecur.h"
+#include "CICalendarManager.h"
+#include "CICalendarPeriod.h"
+#include "CICalendarRecurrenceSet.h"
+#include "CICalendarVTimezone.h"
+
+#include <algorithm>
+
+using namespace iCal;
+
+static const int64_t cSecondsPerWeek = 7 * 24 * 60 * 60;
+
+// 1970-01-01 was a Thursday
+static const int64_t cMondayOffset = 3 * 24 * 60 * 60;
+
+// Covers any timezone offset difference and date-only comparisons
+static const int64_t cWeekPadding = 2 * 24 * 60 * 60;
+
+static int64_t week_number(int64_t posix)
+{
+	posix += cMondayOffset;
+	return (posix >= 0) ? posix / cSecondsPerWeek : (posix - cSecondsPerWeek + 1) / cSecondsPerWeek;
+}
+
+// Monday of the week in UTC
+static CICalendarDateTime week_start(int64_t week)
+{
+	// Civil date from days since 1970-01-01 (proleptic Gregorian)
+	int64_t days = week * 7 - 3 + 719468;
+	int64_t era = ((days >= 0) ? days : days - 146096) / 146097;
+	int64_t day_of_era = days - era * 146097;
+	int64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+	int64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+	int64_t month_index = (5 * day_of_year + 2) / 153;
+	int32_t day = day_of_year - (153 * month_index + 2) / 5 + 1;
+	int32_t month = (month_index < 10) ? month_index + 3 : month_index - 9;
+	int32_t year = year_of_era + era * 400 + ((month <= 2) ? 1 : 0);
+
+	CICalendarTimezone utc(true);
+	return CICalendarDateTime(year, month, day, 0, 0, 0, &utc);
+}
+
+static uint32_t timezone_epoch()
+{
+	return CICalendarManager::GetDefaultTimezoneGeneration() + CICalendarVTimezone::GetGeneration();
+}
+
+static bool sort_by_rid(const std::pair<const CICalendarDateTime*, const CICalendarInstance*>& e1,
+						const std::pair<const CICalendarDateTime*, const CICalendarInstance*>& e2)
+{
+	return *e1.first < *e2.first;
+}
+
+bool CICalendarInstanceCache::CanCache(const CICalendarComponentRecur* master)
+{
+	// RDATE and EXDATE periods match on overlap rather than on their start
+	const CICalendarRecurrenceSet* recurs = master->GetRecurrenceSet();
+	return master->IsRecurring() && !master->IsRecurrenceInstance() &&
+			recurs->GetPeriods().empty() && recurs->GetExperiods().empty();
+}
+
+void CICalendarInstanceCache::ExpandPeriod(CICalendarComponentRecur* master, const CICalendarPeriod& period, CICalendarInstanceList& list)
+{
+	// Instances move if the timezones change
+	if (mEpoch != timezone_epoch())
+	{
+		clear();
+		mEpoch = timezone_epoch();
+	}
+
+	SMaster& entry = GetMaster(master);
+
+	// Every instance in the period is in one of these weeks
+	int64_t first = week_number(period.GetStart().GetPosixTime() - cWeekPadding);
+	int64_t last = week_number(period.GetEnd().GetPosixTime() + cWeekPadding);
+	Fill(entry, first, last);
+
+	// Weeks overlap the period at each end
+	std::vector<std::pair<const CICalendarDateTime*, const CICalendarInstance*> > found;
+	for(CWeeks::const_iterator week = entry.mWeeks.lower_bound(first); (week != entry.mWeeks.end()) && ((*week).first <= last); week++)
+	{
+		for(CInstances::const_iterator iter = (*week).second.begin(); iter != (*week).second.end(); iter++)
+		{
+			if (period.IsDateWithinPeriod((*iter).mRecurrenceID))
+				found.push_back(std::make_pair(&(*iter).mRecurrenceID, &(*iter).mInstance));
+		}
+	}
+
+	// Same order as a direct expansion
+	std::sort(found.begin(), found.end(), sort_by_rid);
+	list.reserve(list.size() + found.size());
+	for(std::vector<std::pair<const CICalendarDateTime*, const CICalendarInstance*> >::const_iterator iter = found.begin(); iter != found.end(); iter++)
+		list.push_back(*(*iter).second);
+}
+
+void CICalendarInstanceCache::Invalidate(const cdstring& uid)
+{
+	if (!mMasters.empty())
+		mMasters.erase(uid);
+}
+
+void CICalendarInstanceCache::clear()
+{
+	mMasters.clear();
+}
+
+CICalendarInstanceCache::SMaster& CICalendarInstanceCache::GetMaster(CICalendarComponentRecur* master)
+{
+	SMaster& entry = mMasters[master->GetUID()];
+
+	// Master replaced without being invalidated
+	if (entry.mMaster != master)
+	{
+		entry.mMaster = master;
+		entry.mWeeks.clear();
+	}
+
+	return entry;
+}
+
+// Fill in any missing weeks from first to last inclusive
+void CICalendarInstanceCache::Fill(SMaster& entry, int64_t first, int64_t last)
+{
+	int64_t week = first;
+	CWeeks::const_iterator filled = entry.mWeeks.lower_bound(first);
+	while(week <= last)
+	{
+		// Skip filled weeks
+		if ((filled != entry.mWeeks.end()) && ((*filled).first == week))
+		{
+			week++;
+			filled++;
+			continue;
+		}
+
+		// Expand a run of missing weeks in one go
+		int64_t run_end = ((filled != entry.mWeeks.end()) && ((*filled).first <= last)) ? (*filled).first - 1 : last;
+
+		std::vector<CICalendarDateTime> starts;
+		starts.reserve(run_end - week + 2);
+		for(int64_t i = week; i <= run_end + 1; i++)
+			starts.push_back(week_start(i));
+
+		CICalendarInstanceList expanded;
+		CICalendarDateTimeList rids;
+		entry.mMaster->ExpandPeriod(CICalendarPeriod(starts.front(), starts.back()), expanded, &rids);
+
+		// Every week in the run is now filled even if it has no instances
+		std::vector<CInstances*> weeks;
+		weeks.reserve(run_end - week + 1);
+		for(int64_t i = week; i <= run_end; i++)
+			weeks.push_back(&entry.mWeeks[i]);
+
+		// Put each one in the week whose period it is within
+		for(size_t i = 0; i < rids.size(); i++)
+		{
+			SInstance instance;
+			instance.mRecurrenceID = rids[i];
+			instance.mInstance = expanded[i];
+
+			int64_t guess = week_number(rids[i].GetPosixTime()) - week;
+			int64_t run_length = run_end - week + 1;
+			int64_t item_week = std::min(std::max(guess, (int64_t)0), run_length - 1);
+			for(int64_t j = std::max(guess - 1, (int64_t)0); j <= std::min(guess + 1, run_length - 1); j++)
+			{
+				if ((rids[i] >= starts[j]) && (rids[i] < starts[j + 1]))
+				{
+					item_week = j;
+					break;
+				}
+			}
+			weeks[item_week]->push_back(instance);
+		}
+
+		week = run_end + 1;
+		filled = entry.mWeeks.lower_bound(week);
+	}
+}
@@ -0,0 +1,95 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+	CICalendarInstanceCache.h
+
+	Author:
+	Description:	expanded instances of recurring components cached by week
+*/
+
+#ifndef CICalendarInstanceCache_H
+#define CICalendarInstanceCache_H
+
+#include "CICalendarDateTime.h"
+#include "CICalendarInstance.h"
+
+#include "cdstring.h"
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+namespace iCal {
+
+class CICalendarComponentRecur;
+class CICalendarPeriod;
+
+// Expanded instances of each recurring master, kept per week from Monday 00:00 UTC. A week is
+// filled the first time a query covers it, and copies of the same instances are returned to
+// every query after that. Everything for a UID is dropped when the master or any of its overridden
+// instances changes, and everything is dropped when the timezones change.
+
+class CICalendarInstanceCache
+{
+public:
+	CICalendarInstanceCache()
+		{ mEpoch = 0; }
+	~CICalendarInstanceCache() {}
+
+	// Only sets whose instances can be found by their start alone
+	static bool CanCache(const CICalendarComponentRecur* master);
+
+	// Same result as CICalendarComponentRecur::ExpandPeriod
+	void ExpandPeriod(CICalendarComponentRecur* master, const CICalendarPeriod& period, CICalendarInstanceList& list);
+
+	void Invalidate(const cdstring& uid);
+	void clear();
+
+private:
+	struct SInstance
+	{
+		CICalendarDateTime	mRecurrenceID;
+		CICalendarInstance	mInstance;
+	};
+	typedef std::vector<SInstance> CInstances;
+	typedef std::map<int64_t, CInstances> CWeeks;
+
+	struct SMaster
+	{
+		CICalendarComponentRecur*	mMaster;
+		CWeeks						mWeeks;
+
+		SMaster()
+			: mMaster(NULL) {}
+	};
+
+	typedef std::map<cdstring, SMaster> CMasters;
+
+	CMasters	mMasters;		// UID -> cached weeks
+	uint32_t	mEpoch;			// Timezones used to fill the cache
+
+	SMaster&	GetMaster(CICalendarComponentRecur* master);
+	void		Fill(SMaster& entry, int64_t first, int64_t last);
+
+	// Not copyable - owned by one calendar
+	CICalendarInstanceCache(const CICalendarInstanceCache& copy);
+	CICalendarInstanceCache& operator=(const CICalendarInstanceCache& copy);
+};
+
+}	// namespace iCal
+
+#endif	// CICalendarInstanceCache_H
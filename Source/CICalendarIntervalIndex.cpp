@@ -0,0 +1,186 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+	CICalendarIntervalIndex.cpp
+
+	Author:
+	Description:	index of component time spans for period queries
+*/
+
+#include "CICalendarIntervalIndex.h"
+
+#include "CICalendarComponentDB.h"
+#include "CICalendarComponentRecur.h"
+#include "CICalendarPeriod.h"
+#include "CICalendarRecurrenceSet.h"
+
+using namespace iCal;
+
+// Covers any timezone offset difference and date-only comparisons
+static const int64_t cSpanPadding = 2 * 24 * 60 * 60;
+
+static const int64_t cOpenEnd = 0x7FFFFFFFFFFFFFFFLL;
+
+static void get_span(const CICalendarComponentRecur* comp, int64_t& start, int64_t& end)
+{
+	start = comp->GetStart().GetPosixTime();
+	if (!comp->IsRecurring())
+	{
+		end = comp->GetEnd().GetPosixTime();
+		start -= cSpanPadding;
+		end += cSpanPadding;
+		return;
+	}
+
+	// Instances start anywhere from DTSTART to the last UNTIL or RDATE
+	const CICalendarRecurrenceSet* recurs = comp->GetRecurrenceSet();
+	end = start;
+	for(CICalendarRecurrenceList::const_iterator iter = recurs->GetRules().begin(); iter != recurs->GetRules().end(); iter++)
+	{
+		// Not worth counting instances to find where COUNT ends
+		if (!(*iter).GetUseUntil())
+		{
+			end = cOpenEnd;
+			break;
+		}
+		int64_t until = (*iter).GetUntil().GetPosixTime();
+		if (until > end)
+			end = until;
+	}
+	for(CICalendarDateTimeList::const_iterator iter = recurs->GetDates().begin(); iter != recurs->GetDates().end(); iter++)
+	{
+		int64_t rdate = (*iter).GetPosixTime();
+		if (rdate < start)
+			start = rdate;
+		if ((end != cOpenEnd) && (rdate > end))
+			end = rdate;
+	}
+	for(CICalendarPeriodList::const_iterator iter = recurs->GetPeriods().begin(); iter != recurs->GetPeriods().end(); iter++)
+	{
+		int64_t rperiod = (*iter).GetStart().GetPosixTime();
+		if (rperiod < start)
+			start = rperiod;
+		if ((end != cOpenEnd) && (rperiod > end))
+			end = rperiod;
+	}
+
+	start -= cSpanPadding;
+	if (end != cOpenEnd)
+	{
+		// Last instance lasts as long as the first
+		int64_t duration = comp->GetEnd().GetPosixTime() - comp->GetStart().GetPosixTime();
+		end += ((duration > 0) ? duration : 0) + cSpanPadding;
+	}
+}
+
+void CICalendarIntervalIndex::Build(const CICalendarComponentDB& db)
+{
+	clear();
+	mBuilt = true;
+	for(CICalendarComponentDB::const_iterator iter = db.begin(); iter != db.end(); iter++)
+		Add(static_cast<CICalendarComponentRecur*>((*iter).second));
+}
+
+void CICalendarIntervalIndex::Add(CICalendarComponentRecur* comp)
+{
+	if (!mBuilt)
+		return;
+
+	SEntry entry;
+	entry.mComponent = comp;
+
+	SSpan span;
+	get_span(comp, span.mStart, entry.mEnd);
+
+	// Smallest power of two at least as long as the span
+	if (entry.mEnd == cOpenEnd)
+		span.mClass = cOpenClass;
+	else
+	{
+		int64_t length = entry.mEnd - span.mStart;
+		span.mClass = 0;
+		while((span.mClass < cClassCount - 1) && ((1LL << span.mClass) < length))
+			span.mClass++;
+	}
+
+	mClasses[span.mClass].insert(CStartMap::value_type(span.mStart, entry));
+	mSpans[comp] = span;
+}
+
+void CICalendarIntervalIndex::Remove(const CICalendarComponentRecur* comp)
+{
+	CSpanMap::iterator found = mSpans.find(comp);
+	if (found == mSpans.end())
+		return;
+
+	CStartMap& starts = mClasses[(*found).second.mClass];
+	std::pair<CStartMap::iterator, CStartMap::iterator> range = starts.equal_range((*found).second.mStart);
+	for(CStartMap::iterator iter = range.first; iter != range.second; iter++)
+	{
+		if ((*iter).second.mComponent == comp)
+		{
+			starts.erase(iter);
+			break;
+		}
+	}
+	mSpans.erase(found);
+}
+
+// Timing or recurrence may have changed
+void CICalendarIntervalIndex::Update(CICalendarComponentRecur* comp)
+{
+	if (mSpans.count(comp) != 0)
+	{
+		Remove(comp);
+		Add(comp);
+	}
+}
+
+void CICalendarIntervalIndex::clear()
+{
+	for(uint32_t i = 0; i <= cClassCount; i++)
+		mClasses[i].clear();
+	mSpans.clear();
+	mBuilt = false;
+}
+
+void CICalendarIntervalIndex::Find(const CICalendarPeriod& period, CICalendarComponentRecurs& found) const
+{
+	int64_t period_start = period.GetStart().GetPosixTime();
+	int64_t period_end = period.GetEnd().GetPosixTime();
+
+	for(uint32_t i = 0; i < cClassCount; i++)
+	{
+		const CStartMap& starts = mClasses[i];
+		if (starts.empty())
+			continue;
+
+		// Nothing in this group that starts further back can reach the period
+		CStartMap::const_iterator last = starts.lower_bound(period_end);
+		for(CStartMap::const_iterator iter = starts.lower_bound(period_start - (1LL << i)); iter != last; iter++)
+		{
+			if ((*iter).second.mEnd > period_start)
+				found.push_back((*iter).second.mComponent);
+		}
+	}
+
+	// Open-ended ones only need to start before the end
+	const CStartMap& open = mClasses[cOpenClass];
+	CStartMap::const_iterator last = open.lower_bound(period_end);
+	for(CStartMap::const_iterator iter = open.begin(); iter != last; iter++)
+		found.push_back((*iter).second.mComponent);
+}
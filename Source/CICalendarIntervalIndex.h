@@ -0,0 +1,98 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+	CICalendarIntervalIndex.h
+
+	Author:
+	Description:	index of component time spans for period queries
+*/
+
+#ifndef CICalendarIntervalIndex_H
+#define CICalendarIntervalIndex_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+namespace iCal {
+
+class CICalendarComponentDB;
+class CICalendarComponentRecur;
+typedef std::vector<CICalendarComponentRecur*> CICalendarComponentRecurs;
+class CICalendarPeriod;
+
+// Each component is indexed by the span of time it can have instances in: [DTSTART, DTEND)
+// for a single instance, or from the earliest to the latest start of a recurrence set
+// (open-ended when a rule has no UNTIL). Spans are padded so that timezone and date-only
+// differences never exclude a component - results are candidates that still need to be
+// checked against the period.
+//
+// Spans are grouped by the power of two just above their length with each group sorted on
+// start, so a query only looks at starts no more than that length before the period.
+
+class CICalendarIntervalIndex
+{
+public:
+	CICalendarIntervalIndex()
+		{ mBuilt = false; }
+	~CICalendarIntervalIndex() {}
+
+	// Nothing is indexed until the first query
+	bool IsBuilt() const
+		{ return mBuilt; }
+	void Build(const CICalendarComponentDB& db);
+
+	// These do nothing until built
+	void Add(CICalendarComponentRecur* comp);
+	void Remove(const CICalendarComponentRecur* comp);
+	void Update(CICalendarComponentRecur* comp);
+
+	void clear();
+
+	// Components that may have instances within the period
+	void Find(const CICalendarPeriod& period, CICalendarComponentRecurs& found) const;
+
+private:
+	static const uint32_t	cClassCount = 63;
+	static const uint32_t	cOpenClass = cClassCount;
+
+	struct SEntry
+	{
+		CICalendarComponentRecur*	mComponent;
+		int64_t						mEnd;
+	};
+	typedef std::multimap<int64_t, SEntry> CStartMap;
+
+	struct SSpan
+	{
+		int64_t		mStart;
+		uint32_t	mClass;
+	};
+	typedef std::map<const CICalendarComponentRecur*, SSpan> CSpanMap;
+
+	bool		mBuilt;
+	CStartMap	mClasses[cClassCount + 1];		// Last one is open-ended spans
+	CSpanMap	mSpans;
+
+	// Not copyable - owned by one calendar
+	CICalendarIntervalIndex(const CICalendarIntervalIndex& copy);
+	CICalendarIntervalIndex& operator=(const CICalendarIntervalIndex& copy);
+};
+
+}	// namespace iCal
+
+#endif	// CICalendarIntervalIndex_H
@@ -35,38 +35,50 @@
 #include "diriterator.h"
 #include "cdfstream.h"
 
+#include <ctime>
+
+#if __dest_os == __linux_os || __dest_os == __mac_os_x
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace iCal;
 
 CICalendarManager* CICalendarManager::sICalendarManager = NULL;
+uint32_t CICalendarManager::sDefaultTimezoneGeneration = 1;
 
 CICalendarManager::CICalendarManager()
 {
+	mTimezoneLoadCount = 0;
+	mTimezoneLoadTime = 0;
 	sICalendarManager = this;
+	sDefaultTimezoneGeneration++;
 }
 
 CICalendarManager::~CICalendarManager()
 {
 	sICalendarManager = NULL;
+	sDefaultTimezoneGeneration++;
 }
 
 const char* cTimezonesDir = "Timezones";
+const char* cTimezonesTable = "Timezones.tzdb";
 
 void CICalendarManager::InitManager()
 {
 #ifdef __MULBERRY
 	// Need to have timezones cached before starting any UI work as timezone popup needs them
+	cdstrvect tzdirs;
 	for(cdstrvect::const_iterator iter = CPluginManager::sPluginManager.GetPluginDirs().begin(); iter != CPluginManager::sPluginManager.GetPluginDirs().end(); iter++)
 	{
 		cdstring tzpath = *iter;
 		::addtopath(tzpath, cTimezonesDir);
-		ScanDirectoryForTimezones(tzpath);
-	}
-	
-	// Need to have timezones cached before starting any UI work as timezone popup needs them
-	{
-		cdstring tzpath = CConnectionManager::sConnectionManager.GetTimezonesDirectory();
-		ScanDirectoryForTimezones(tzpath);
+		tzdirs.push_back(tzpath);
 	}
+	tzdirs.push_back(CConnectionManager::sConnectionManager.GetTimezonesDirectory());
+	LoadTimezones(tzdirs);
 	
 	// Eventually we need to read these from prefs - for now they are hard-coded to my personal prefs!
 	
@@ -74,7 +86,50 @@ void CICalendarManager::InitManager()
 #endif
 }
 
+// Load all timezone files found in the directories in one pass
+void CICalendarManager::LoadTimezones(const cdstrvect& dirs)
+{
+	std::clock_t start = std::clock();
+
+	// Gather the complete file list first
+	mTimezoneLoadCount = 0;
+	cdstrvect files;
+	for(cdstrvect::const_iterator iter = dirs.begin(); iter != dirs.end(); iter++)
+	{
+		// A precompiled table replaces the files in its directory
+		if (!mTimezoneTable.IsLoaded())
+		{
+			cdstring tpath = *iter;
+			::addtopath(tpath, cTimezonesTable);
+			if (LoadTimezoneTable(tpath))
+			{
+				mTimezoneLoadCount++;
+				continue;
+			}
+		}
+
+		ScanDirectoryForTimezones(*iter, files);
+	}
+
+	// Now parse each one straight into the static calendar
+	for(cdstrvect::const_iterator iter = files.begin(); iter != files.end(); iter++)
+	{
+		if (LoadTimezoneFile(*iter))
+			mTimezoneLoadCount++;
+	}
+
+	// Load time in milliseconds
+	mTimezoneLoadTime = (std::clock() - start) * 1000 / CLOCKS_PER_SEC;
+}
+
 void CICalendarManager::ScanDirectoryForTimezones(const cdstring& dir)
+{
+	cdstrvect dirs;
+	dirs.push_back(dir);
+	LoadTimezones(dirs);
+}
+
+void CICalendarManager::ScanDirectoryForTimezones(const cdstring& dir, cdstrvect& files)
 {
 	diriterator iter(dir, true, ".ics");
 	iter.set_return_hidden_files(false);
@@ -89,14 +144,129 @@ void CICalendarManager::ScanDirectoryForTimezones(const cdstring& dir)
 		if (iter.is_dir())
 		{
 			// Scan more
-			ScanDirectoryForTimezones(fpath);
+			ScanDirectoryForTimezones(fpath, files);
 		}
 		else
+			files.push_back(fpath);
+	}
+}
+
+bool CICalendarManager::LoadTimezoneFile(const cdstring& fpath)
+{
+	// Parse directly from the file contents
+	const char* data = NULL;
+	size_t length = 0;
+	if (!MapFile(fpath, data, length))
+		return false;
+
+	bool result = iCal::CICalendar::getSICalendar().Parse(data, length);
+	UnmapFile(data, length);
+
+	return result;
+}
+
+bool CICalendarManager::LoadTimezoneTable(const cdstring& fpath)
+{
+	UnloadTimezoneTable();
+
+	// Table points directly into the file contents so keep them around
+	if (!MapFile(fpath, mTimezoneTableData, mTimezoneTableLength))
+		return false;
+
+	if (!mTimezoneTable.Load(mTimezoneTableData, mTimezoneTableLength))
+	{
+		UnloadTimezoneTable();
+		return false;
+	}
+
+	iCal::CICalendar::getSICalendar().SetTimezoneTable(&mTimezoneTable);
+	sDefaultTimezoneGeneration++;
+	return true;
+}
+
+void CICalendarManager::UnloadTimezoneTable()
+{
+	if (iCal::CICalendar::getSICalendar().GetTimezoneTable() == &mTimezoneTable)
+	{
+		iCal::CICalendar::getSICalendar().SetTimezoneTable(NULL);
+		sDefaultTimezoneGeneration++;
+	}
+	mTimezoneTable.Clear();
+
+	if (mTimezoneTableData != NULL)
+	{
+		UnmapFile(mTimezoneTableData, mTimezoneTableLength);
+		mTimezoneTableData = NULL;
+		mTimezoneTableLength = 0;
+	}
+}
+
+// Write all timezones currently loaded into a precompiled table
+bool CICalendarManager::CompileTimezoneTable(const cdstring& fpath, int32_t start_year, int32_t end_year) const
+{
+	cdofstream fout(fpath.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+	if (fout.fail())
+		return false;
+
+	return CICalendarTimezoneTable::Compile(iCal::CICalendar::getSICalendar(), start_year, end_year, fout);
+}
+
+bool CICalendarManager::MapFile(const cdstring& fpath, const char*& data, size_t& length)
+{
+#if __dest_os == __linux_os || __dest_os == __mac_os_x
+	// Map the file into memory
+	int fd = ::open(fpath.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	bool result = false;
+	struct stat finfo;
+	if ((::fstat(fd, &finfo) == 0) && (finfo.st_size > 0))
+	{
+		void* mapped = ::mmap(NULL, finfo.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped != MAP_FAILED)
 		{
-			cdifstream fin(fpath.c_str());
-			iCal::CICalendar::getSICalendar().Parse(fin);
+			data = static_cast<const char*>(mapped);
+			length = finfo.st_size;
+			result = true;
 		}
 	}
+	::close(fd);
+
+	return result;
+#else
+	// Read the whole file into memory
+	cdifstream fin(fpath.c_str(), std::ios_base::in | std::ios_base::binary);
+	if (fin.fail())
+		return false;
+
+	fin.seekg(0, std::ios_base::end);
+	std::streamoff size = fin.tellg();
+	fin.seekg(0, std::ios_base::beg);
+	if (size <= 0)
+		return false;
+
+	char* buffer = new char[size];
+	fin.read(buffer, size);
+	if (fin.gcount() != size)
+	{
+		delete [] buffer;
+		return false;
+	}
+
+	data = buffer;
+	length = size;
+	return true;
+#endif
+}
+
+void CICalendarManager::UnmapFile(const char* data, size_t length)
+{
+#if __dest_os == __linux_os || __dest_os == __mac_os_x
+	::munmap(const_cast<char*>(data), length);
+#else
+	delete [] data;
+#endif
 }
 
 void CICalendarManager::SetDefaultTimezoneID(const cdstring& tzid)
@@ -25,6 +25,7 @@
 #define CICalendarManager_H
 
 #include "CICalendarTimezone.h"
+#include "CICalendarTimezoneTable.h"
 
 #include "cdstring.h"
 
@@ -45,17 +46,53 @@ public:
 	void SetDefaultTimezone(const CICalendarTimezone& tzid)
 	{
 		mDefaultTimezone = tzid;
+		sDefaultTimezoneGeneration++;
 	}
 	cdstring GetDefaultTimezoneID() const;
 	const CICalendarTimezone& GetDefaultTimezone() const
 	{
 		return mDefaultTimezone;
 	}
+
+	// Changes whenever floating date-times may resolve to a different offset
+	static uint32_t GetDefaultTimezoneGeneration()
+	{
+		return sDefaultTimezoneGeneration;
+	}
+
+	void LoadTimezones(const cdstrvect& dirs);
+
+	// Precompiled timezones
+	bool LoadTimezoneTable(const cdstring& fpath);
+	bool CompileTimezoneTable(const cdstring& fpath, int32_t start_year, int32_t end_year) const;
+
+	// Stats for last timezone load
+	uint32_t GetTimezoneLoadCount() const
+	{
+		return mTimezoneLoadCount;
+	}
+	uint32_t GetTimezoneLoadTime() const
+	{
+		return mTimezoneLoadTime;
+	}
 	
 protected:	
+	static uint32_t						sDefaultTimezoneGeneration;
+
 	CICalendarTimezone					mDefaultTimezone;
+	uint32_t							mTimezoneLoadCount;
+	uint32_t							mTimezoneLoadTime;
+	CICalendarTimezoneTable				mTimezoneTable;
+	const char*							mTimezoneTableData;
+	size_t								mTimezoneTableLength;
 
 	void ScanDirectoryForTimezones(const cdstring& dir);
+	void ScanDirectoryForTimezones(const cdstring& dir, cdstrvect& files);
+	bool LoadTimezoneFile(const cdstring& fpath);
+	void UnloadTimezoneTable();
+
+	static bool MapFile(const cdstring& fpath, const char*& data, size_t& length);
+	static void UnmapFile(const char* data, size_t length);
 };
 
 }	// namespace iCal
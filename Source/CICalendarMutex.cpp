@@ -0,0 +1,89 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+
+/*
+	CICalendarMutex.cpp
+
+	Author:
+	Description:	locking and publishing of lazily built state for concurrent readers
+*/
+
+#include "CICalendarMutex.h"
+
+using namespace iCal;
+
+CICalendarMutex::CICalendarMutex()
+{
+	_init_CICalendarMutex();
+}
+
+CICalendarMutex::CICalendarMutex(const CICalendarMutex& copy)
+{
+	_init_CICalendarMutex();
+}
+
+CICalendarMutex::~CICalendarMutex()
+{
+#if __dest_os == __win32_os
+	::DeleteCriticalSection(&mMutex);
+#elif __dest_os == __linux_os || __dest_os == __mac_os_x
+	::pthread_mutex_destroy(&mMutex);
+#endif
+}
+
+void CICalendarMutex::_init_CICalendarMutex()
+{
+#if __dest_os == __win32_os
+	// Critical sections are always recursive
+	::InitializeCriticalSection(&mMutex);
+#elif __dest_os == __linux_os || __dest_os == __mac_os_x
+	pthread_mutexattr_t attr;
+	::pthread_mutexattr_init(&attr);
+	::pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	::pthread_mutex_init(&mMutex, &attr);
+	::pthread_mutexattr_destroy(&attr);
+#endif
+}
+
+void CICalendarMutex::Lock()
+{
+#if __dest_os == __win32_os
+	::EnterCriticalSection(&mMutex);
+#elif __dest_os == __linux_os || __dest_os == __mac_os_x
+	::pthread_mutex_lock(&mMutex);
+#endif
+}
+
+void CICalendarMutex::Unlock()
+{
+#if __dest_os == __win32_os
+	::LeaveCriticalSection(&mMutex);
+#elif __dest_os == __linux_os || __dest_os == __mac_os_x
+	::pthread_mutex_unlock(&mMutex);
+#endif
+}
+
+void CICalendarMutex::Increment(uint32_t& counter)
+{
+#if __dest_os == __win32_os
+	::InterlockedIncrement(reinterpret_cast<volatile LONG*>(&counter));
+#elif defined(__GNUC__)
+	__atomic_add_fetch(&counter, 1, __ATOMIC_ACQ_REL);
+#else
+	counter++;
+#endif
+}
@@ -0,0 +1,116 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+
+/*
+	CICalendarMutex.h
+
+	Author:
+	Description:	locking and publishing of lazily built state for concurrent readers
+*/
+
+#ifndef CICalendarMutex_H
+#define CICalendarMutex_H
+
+#if __dest_os == __win32_os
+#include <windows.h>
+#elif __dest_os == __linux_os || __dest_os == __mac_os_x
+#include <pthread.h>
+#endif
+
+#include <stdint.h>
+
+// Per-thread storage for statics
+#if __dest_os == __win32_os
+#define CICALENDAR_THREAD_LOCAL	__declspec(thread)
+#elif __dest_os == __linux_os || __dest_os == __mac_os_x
+#define CICALENDAR_THREAD_LOCAL	__thread
+#else
+#define CICALENDAR_THREAD_LOCAL
+#endif
+
+namespace iCal {
+
+// Const query methods build caches on first use. Any number of threads may query the same
+// calendar at once provided nothing is changing it. Caches that are built once publish a
+// flag with StoreRelease after the cached data is written, and readers test that flag with
+// LoadAcquire before reading the data. Caches that grow are guarded by a mutex.
+//
+// Mutexes are recursive. A copy of a mutex is a new unlocked mutex so that objects holding one
+// can still be copied.
+
+class CICalendarMutex
+{
+public:
+	CICalendarMutex();
+	CICalendarMutex(const CICalendarMutex& copy);
+	~CICalendarMutex();
+
+	CICalendarMutex& operator=(const CICalendarMutex& copy)
+		{ return *this; }
+
+	void Lock();
+	void Unlock();
+
+	// Lock for the lifetime of this object
+	class StLock
+	{
+	public:
+		explicit StLock(CICalendarMutex& mutex)
+			: mMutex(mutex) { mMutex.Lock(); }
+		~StLock()
+			{ mMutex.Unlock(); }
+
+	private:
+		CICalendarMutex&	mMutex;
+
+		StLock(const StLock& copy);
+		StLock& operator=(const StLock& copy);
+	};
+
+	template<class T> static T LoadAcquire(const T& flag)
+	{
+#if defined(__GNUC__)
+		return __atomic_load_n(&flag, __ATOMIC_ACQUIRE);
+#else
+		return *static_cast<const volatile T*>(&flag);
+#endif
+	}
+
+	template<class T> static void StoreRelease(T& flag, T value)
+	{
+#if defined(__GNUC__)
+		__atomic_store_n(&flag, value, __ATOMIC_RELEASE);
+#else
+		*static_cast<volatile T*>(&flag) = value;
+#endif
+	}
+
+	static void Increment(uint32_t& counter);
+
+private:
+#if __dest_os == __win32_os
+	CRITICAL_SECTION	mMutex;
+#elif __dest_os == __linux_os || __dest_os == __mac_os_x
+	pthread_mutex_t		mMutex;
+#endif
+
+	void _init_CICalendarMutex();
+};
+
+}	// namespace iCal
+
+#endif	// CICalendarMutex_H
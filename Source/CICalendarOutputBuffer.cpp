@@ -0,0 +1,176 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+	CICalendarOutputBuffer.cpp
+
+	Author:
+	Description:	reusable output buffer that folds lines in place
+*/
+
+#include "CICalendarOutputBuffer.h"
+
+#include <cstring>
+
+#include "cdstring.h"
+
+using namespace iCal;
+
+CICalendarOutputBuffer::CICalendarOutputBuffer(std::ostream& os, size_t chunk) :
+	mStream(os)
+{
+	mData = NULL;
+	mCapacity = 0;
+	mChunk = chunk;
+	mLineStart = cNoLine;
+
+	// Pre-size for a full chunk
+	Reserve(mChunk);
+}
+
+CICalendarOutputBuffer::~CICalendarOutputBuffer()
+{
+	Flush();
+	delete [] mData;
+}
+
+// Start of a line that may need folding
+void CICalendarOutputBuffer::BeginLine()
+{
+	mLineStart = GetLength();
+}
+
+// Fold the line just written and write out the buffer if it is big enough
+void CICalendarOutputBuffer::EndLine()
+{
+	if (mLineStart != cNoLine)
+	{
+		FoldLine(mLineStart);
+		mLineStart = cNoLine;
+	}
+}
+
+bool CICalendarOutputBuffer::Flush()
+{
+	// Never split a line that is still to be folded
+	if (mLineStart != cNoLine)
+		return true;
+
+	size_t length = GetLength();
+	if (length != 0)
+	{
+		mStream.write(mData, length);
+		setp(mData, mData + mCapacity);
+	}
+
+	return !mStream.fail();
+}
+
+CICalendarOutputBuffer::int_type CICalendarOutputBuffer::overflow(int_type c)
+{
+	if (traits_type::eq_int_type(c, traits_type::eof()))
+		return traits_type::not_eof(c);
+
+	char ch = traits_type::to_char_type(c);
+	xsputn(&ch, 1);
+	return c;
+}
+
+std::streamsize CICalendarOutputBuffer::xsputn(const char* s, std::streamsize n)
+{
+	// Write out a full chunk before adding more
+	if ((mLineStart == cNoLine) && (GetLength() >= mChunk))
+		Flush();
+
+	Reserve(GetLength() + n);
+	::memcpy(pptr(), s, n);
+	pbump(n);
+
+	return n;
+}
+
+int CICalendarOutputBuffer::sync()
+{
+	if (!Flush())
+		return -1;
+	mStream.flush();
+	return mStream.fail() ? -1 : 0;
+}
+
+void CICalendarOutputBuffer::Reserve(size_t length)
+{
+	if (length <= mCapacity)
+		return;
+
+	// Grow geometrically and keep existing contents
+	size_t capacity = (mCapacity != 0) ? mCapacity : 256;
+	while(capacity < length)
+		capacity *= 2;
+
+	size_t current = GetLength();
+	char* data = new char[capacity];
+	if (current != 0)
+		::memcpy(data, mData, current);
+	delete [] mData;
+
+	mData = data;
+	mCapacity = capacity;
+	setp(mData, mData + mCapacity);
+	pbump(current);
+}
+
+// Insert line breaks into the line from start to the end of the buffer
+void CICalendarOutputBuffer::FoldLine(size_t start)
+{
+	size_t end = GetLength();
+	if (end - start <= cFoldLength)
+		return;
+
+	// Find the break points first
+	mFolds.clear();
+	const unsigned char* up = reinterpret_cast<const unsigned char*>(mData);
+	size_t pos = start;
+	while(end - pos > cFoldLength)
+	{
+		size_t bytes = cFoldLength;
+
+		// Make sure we do not split in the middle of a utf-8 multi-octet sequence
+		while((bytes > 1) && (up[pos + bytes] > 0x7F) && ((up[pos + bytes] & 0xC0) == 0x80))
+			bytes--;
+
+		pos += bytes;
+		mFolds.push_back(pos);
+	}
+
+	// Now move each segment up from the end to make room for the line breaks
+	size_t endl_length = ::strlen(net_endl);
+	size_t fold_length = endl_length + 1;
+	size_t extra = mFolds.size() * fold_length;
+	Reserve(end + extra);
+
+	size_t segment_end = end;
+	for(std::vector<size_t>::const_reverse_iterator iter = mFolds.rbegin(); iter != mFolds.rend(); iter++)
+	{
+		size_t segment_start = *iter;
+		::memmove(mData + segment_start + extra, mData + segment_start, segment_end - segment_start);
+		extra -= fold_length;
+		::memcpy(mData + segment_start + extra, net_endl, endl_length);
+		mData[segment_start + extra + endl_length] = ' ';
+		segment_end = segment_start;
+	}
+
+	pbump(mFolds.size() * fold_length);
+}
@@ -0,0 +1,77 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+	CICalendarOutputBuffer.h
+
+	Author:
+	Description:	reusable output buffer that folds lines in place
+*/
+
+#ifndef CICalendarOutputBuffer_H
+#define CICalendarOutputBuffer_H
+
+#include <ostream>
+#include <stddef.h>
+#include <streambuf>
+#include <vector>
+
+namespace iCal {
+
+// Stream buffer that collects output in memory and writes it to the real stream in large chunks.
+// Lines marked with BeginLine/EndLine are folded in place.
+
+class CICalendarOutputBuffer : public std::streambuf
+{
+public:
+	explicit CICalendarOutputBuffer(std::ostream& os, size_t chunk = cDefaultChunk);
+	virtual ~CICalendarOutputBuffer();
+
+	void BeginLine();
+	void EndLine();
+
+	bool Flush();
+
+protected:
+	virtual int_type		overflow(int_type c);
+	virtual std::streamsize	xsputn(const char* s, std::streamsize n);
+	virtual int				sync();
+
+private:
+	static const size_t		cDefaultChunk = 64 * 1024;
+	static const size_t		cFoldLength = 74;
+	static const size_t		cNoLine = static_cast<size_t>(-1);
+
+	std::ostream&		mStream;
+	char*				mData;
+	size_t				mCapacity;
+	size_t				mChunk;
+	size_t				mLineStart;
+	std::vector<size_t>	mFolds;
+
+	size_t	GetLength() const
+		{ return pptr() - pbase(); }
+	void	Reserve(size_t length);
+	void	FoldLine(size_t start);
+
+	// Not copyable
+	CICalendarOutputBuffer(const CICalendarOutputBuffer& copy);
+	CICalendarOutputBuffer& operator=(const CICalendarOutputBuffer& copy);
+};
+
+}	// namespace iCal
+
+#endif	// CICalendarOutputBuffer_H
@@ -0,0 +1,84 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+	CICalendarPackedDateTime.cpp
+
+	Author:
+	Description:	compact date-time value for large cached lists
+*/
+
+#include "CICalendarPackedDateTime.h"
+
+#include "CICalendarDateTime.h"
+
+using namespace iCal;
+
+CICalendarPackedDateTime::CICalendarPackedDateTime(const CICalendarDateTime& dt)
+{
+	// Fields that will not fit are normalised first
+	CICalendarDateTime temp(dt);
+	if ((temp.GetMonth() < 0) || (temp.GetMonth() > 15) ||
+		(temp.GetDay() < 0) || (temp.GetDay() > 31) ||
+		(temp.GetHours() < 0) || (temp.GetHours() > 31) ||
+		(temp.GetMinutes() < 0) || (temp.GetMinutes() > 63) ||
+		(temp.GetSeconds() < 0) || (temp.GetSeconds() > 63))
+		temp.OffsetSeconds(0);
+
+	int32_t year = temp.GetYear();
+	if (year < 0)
+		year = 0;
+	else if (year > 0xFFFF)
+		year = 0xFFFF;
+
+	mValue = static_cast<uint64_t>(year) << 48;
+	mValue |= static_cast<uint64_t>(temp.GetMonth()) << 44;
+	mValue |= static_cast<uint64_t>(temp.GetDay()) << 39;
+	mValue |= static_cast<uint64_t>(temp.GetHours()) << 34;
+	mValue |= static_cast<uint64_t>(temp.GetMinutes()) << 28;
+	mValue |= static_cast<uint64_t>(temp.GetSeconds()) << 22;
+	if (temp.IsDateOnly())
+		mValue |= cDateOnlyBit;
+	if (temp.GetTimezone().GetUTC())
+		mValue |= cUTCBit;
+	mValue |= temp.GetTimezone().GetTimezoneHandle() & cTimezoneMask;
+}
+
+CICalendarDateTime CICalendarPackedDateTime::GetDateTime() const
+{
+	CICalendarTimezone tzid((mValue & cUTCBit) != 0);
+	tzid.SetTimezoneHandle(mValue & cTimezoneMask);
+
+	CICalendarDateTime result(mValue >> 48,
+								(mValue >> 44) & 0x0F,
+								(mValue >> 39) & 0x1F,
+								(mValue >> 34) & 0x1F,
+								(mValue >> 28) & 0x3F,
+								(mValue >> 22) & 0x3F,
+								&tzid);
+	if (IsDateOnly())
+		result.SetDateOnly(true);
+	return result;
+}
+
+int CICalendarPackedDateTime::CompareDateTime(const CICalendarPackedDateTime& comp) const
+{
+	// Only different timezones need the posix times
+	if (IsDateOnly() || comp.IsDateOnly() || SameTimezone(comp))
+		return Compare(comp);
+	else
+		return GetDateTime().CompareDateTime(comp.GetDateTime());
+}
@@ -0,0 +1,97 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+	CICalendarPackedDateTime.h
+
+	Author:
+	Description:	compact date-time value for large cached lists
+*/
+
+#ifndef CICalendarPackedDateTime_H
+#define CICalendarPackedDateTime_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace iCal {
+
+class CICalendarDateTime;
+
+// Date-time packed into a single 64-bit value (most significant first):
+//
+//   year:16 month:4 day:5 hours:5 minutes:6 seconds:6 date-only:1 utc:1 timezone handle:20
+//
+// Values in the same timezone order the same way as CICalendarDateTime::CompareDateTime.
+// Values in different timezones are converted back to compare them.
+
+class CICalendarPackedDateTime
+{
+public:
+	CICalendarPackedDateTime()
+		{ mValue = 0; }
+	explicit CICalendarPackedDateTime(const CICalendarDateTime& dt);
+
+	CICalendarDateTime GetDateTime() const;
+
+	bool IsDateOnly() const
+		{ return (mValue & cDateOnlyBit) != 0; }
+
+	// Same timezone only
+	int Compare(const CICalendarPackedDateTime& comp) const
+	{
+		// If either are date only, then just do date compare
+		uint64_t key = (IsDateOnly() || comp.IsDateOnly()) ? mValue >> cDateShift : mValue >> cFieldShift;
+		uint64_t comp_key = (IsDateOnly() || comp.IsDateOnly()) ? comp.mValue >> cDateShift : comp.mValue >> cFieldShift;
+		return (key == comp_key) ? 0 : ((key < comp_key) ? -1 : 1);
+	}
+
+	int operator==(const CICalendarPackedDateTime& comp) const
+		{ return Compare(comp) == 0 ? 1 : 0; }
+	int operator<(const CICalendarPackedDateTime& comp) const
+		{ return Compare(comp) < 0 ? 1 : 0; }
+
+	// Same result as CICalendarDateTime::CompareDateTime for any timezones
+	int CompareDateTime(const CICalendarPackedDateTime& comp) const;
+
+	// Same test as comparing the timezones
+	bool SameTimezone(const CICalendarPackedDateTime& comp) const
+	{
+		// Floating matches any timezone
+		if (IsFloating() || comp.IsFloating())
+			return true;
+		else
+			return (mValue & (cUTCBit | cTimezoneMask)) == (comp.mValue & (cUTCBit | cTimezoneMask));
+	}
+
+private:
+	static const int		cDateShift = 39;
+	static const int		cFieldShift = 22;
+	static const uint64_t	cDateOnlyBit = 1ULL << 21;
+	static const uint64_t	cUTCBit = 1ULL << 20;
+	static const uint32_t	cTimezoneMask = (1UL << 20) - 1;
+
+	uint64_t	mValue;
+
+	bool IsFloating() const
+		{ return (mValue & (cUTCBit | cTimezoneMask)) == 0; }
+};
+
+typedef std::vector<CICalendarPackedDateTime> CICalendarPackedDateTimeList;
+
+}	// namespace iCal
+
+#endif	// CICalendarPackedDateTime_H
@@ -29,14 +29,14 @@ using namespace iCal;
 
 void CICalendarPeriod::Parse(const cdstring& data)
 {
+	// Parse each part in place
 	cdstring::size_type slash_pos = data.find('/');
 	if (slash_pos != cdstring::npos)
 	{
-		cdstring start(data, 0, slash_pos);
-		cdstring end(data, slash_pos + 1);
+		const char* end = data.c_str() + slash_pos + 1;
 
-		mStart.Parse(start);
-		if (end[(cdstring::size_type)0] == 'P')
+		mStart.Parse(data.c_str(), slash_pos);
+		if (*end == 'P')
 		{
 			mDuration.Parse(end);
 			mUseDuration = true;
@@ -44,7 +44,7 @@ void CICalendarPeriod::Parse(const cdstring& data)
 		}
 		else
 		{
-			mEnd.Parse(end);
+			mEnd.Parse(end, data.length() - slash_pos - 1);
 			mUseDuration = false;
 			mDuration = mEnd - mStart;
 		}
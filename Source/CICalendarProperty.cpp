@@ -29,6 +29,8 @@
 #include "CICalendarDurationValue.h"
 #include "CICalendarIntegerValue.h"
 #include "CICalendarMultiValue.h"
+#include "CICalendarMutex.h"
+#include "CICalendarOutputBuffer.h"
 #include "CICalendarPeriodValue.h"
 #include "CICalendarPlainTextValue.h"
 #include "CICalendarRecurrenceValue.h"
@@ -39,7 +41,6 @@
 
 #include <iostream>
 #include <memory>
-#include <strstream>
 
 using namespace iCal;
 
@@ -50,6 +51,15 @@ CICalendarProperty::CTypeValueMap CICalendarProperty::sTypeValueMap;
 CICalendarProperty::CMultiValues CICalendarProperty::sMultiValues;
 #endif
 
+static bool sMapsReady = false;
+
+// Function static so that this is available during static initialisation
+static CICalendarMutex& GetPropertyMutex()
+{
+	static CICalendarMutex sMutex;
+	return sMutex;
+}
+
 void CICalendarProperty::_init_attr_value(const int32_t& ival)
 {
 	// Value
@@ -82,8 +92,8 @@ void CICalendarProperty::_init_attr_value(const CICalendarDateTime& dt)
 	// Look for timezone
 	if (!dt.IsDateOnly() && !dt.GetTimezone().GetUTC() && !dt.GetTimezone().GetTimezoneID().empty())
 	{
-		mAttributes.erase(cICalAttribute_TZID);
-		mAttributes.insert(CICalendarAttributeMap::value_type(cICalAttribute_TZID, CICalendarAttribute(cICalAttribute_TZID, dt.GetTimezone().GetTimezoneID())));
+		mAttributes.erase(CICalendarAttribute::eTZID);
+		mAttributes.insert(CICalendarAttribute(CICalendarAttribute::eTZID, dt.GetTimezone().GetTimezoneID()));
 	}
 }
 
@@ -102,8 +112,8 @@ void CICalendarProperty::_init_attr_value(const CICalendarDateTimeList& dtl)
 	// Look for timezone
 	if ((dtl.size() > 0) && !dtl.front().IsDateOnly() && !dtl.front().GetTimezone().GetUTC() && !dtl.front().GetTimezone().GetTimezoneID().empty())
 	{
-		mAttributes.erase(cICalAttribute_TZID);
-		mAttributes.insert(CICalendarAttributeMap::value_type(cICalAttribute_TZID, CICalendarAttribute(cICalAttribute_TZID, dtl.front().GetTimezone().GetTimezoneID())));
+		mAttributes.erase(CICalendarAttribute::eTZID);
+		mAttributes.insert(CICalendarAttribute(CICalendarAttribute::eTZID, dtl.front().GetTimezone().GetTimezoneID()));
 	}
 }
 
@@ -136,6 +146,11 @@ void CICalendarProperty::_init_attr_value(const CICalendarRecurrence& recur)
 
 void CICalendarProperty::_init_map()
 {
+	// Filled once by whichever thread gets here first
+	if (CICalendarMutex::LoadAcquire(sMapsReady))
+		return;
+	CICalendarMutex::StLock lock(GetPropertyMutex());
+
 	// Only if empty
 	if (sDefaultValueTypeMap.empty())
 	{
@@ -257,11 +272,13 @@ void CICalendarProperty::_init_map()
 		sMultiValues.insert(cICalProperty_EXDATE);
 		sMultiValues.insert(cICalProperty_RDATE);
 	}
+
+	CICalendarMutex::StoreRelease(sMapsReady, true);
 }
 
 void CICalendarProperty::AddAttribute(const CICalendarAttribute& attr)
 {
-	mAttributes.insert(CICalendarAttributeMap::value_type(attr.GetName(), attr));
+	mAttributes.insert(attr);
 }
 
 void CICalendarProperty::RemoveAttributes(const cdstring& attr)
@@ -271,55 +288,55 @@ void CICalendarProperty::RemoveAttributes(const cdstring& attr)
 
 const CICalendarCalAddressValue* CICalendarProperty::GetCalAddressValue() const
 {
-	return dynamic_cast<CICalendarCalAddressValue*>(mValue);
+	return dynamic_cast<const CICalendarCalAddressValue*>(GetValue());
 }
 
 const CICalendarDateTimeValue* CICalendarProperty::GetDateTimeValue() const
 {
-	return dynamic_cast<CICalendarDateTimeValue*>(mValue);
+	return dynamic_cast<const CICalendarDateTimeValue*>(GetValue());
 }
 
 const CICalendarDurationValue* CICalendarProperty::GetDurationValue() const
 {
-	return dynamic_cast<CICalendarDurationValue*>(mValue);
+	return dynamic_cast<const CICalendarDurationValue*>(GetValue());
 }
 
 const CICalendarIntegerValue* CICalendarProperty::GetIntegerValue() const
 {
-	return dynamic_cast<CICalendarIntegerValue*>(mValue);
+	return dynamic_cast<const CICalendarIntegerValue*>(GetValue());
 }
 
 const CICalendarMultiValue* CICalendarProperty::GetMultiValue() const
 {
-	return dynamic_cast<CICalendarMultiValue*>(mValue);
+	return dynamic_cast<const CICalendarMultiValue*>(GetValue());
 }
 
 const CICalendarPeriodValue* CICalendarProperty::GetPeriodValue() const
 {
-	return dynamic_cast<CICalendarPeriodValue*>(mValue);
+	return dynamic_cast<const CICalendarPeriodValue*>(GetValue());
 }
 
 const CICalendarRecurrenceValue* CICalendarProperty::GetRecurrenceValue() const
 {
-	return dynamic_cast<CICalendarRecurrenceValue*>(mValue);
+	return dynamic_cast<const CICalendarRecurrenceValue*>(GetValue());
 }
 
 const CICalendarPlainTextValue* CICalendarProperty::GetTextValue() const
 {
-	return dynamic_cast<CICalendarPlainTextValue*>(mValue);
+	return dynamic_cast<const CICalendarPlainTextValue*>(GetValue());
 }
 
 const CICalendarURIValue* CICalendarProperty::GetURIValue() const
 {
-	return dynamic_cast<CICalendarURIValue*>(mValue);
+	return dynamic_cast<const CICalendarURIValue*>(GetValue());
 }
 
 const CICalendarUTCOffsetValue* CICalendarProperty::GetUTCOffsetValue() const
 {
-	return dynamic_cast<CICalendarUTCOffsetValue*>(mValue);
+	return dynamic_cast<const CICalendarUTCOffsetValue*>(GetValue());
 }
 
-bool CICalendarProperty::Parse(cdstring& data)
+bool CICalendarProperty::Parse(cdstring& data, bool lazy)
 {
 	char* p = const_cast<char*>(data.c_str());
 
@@ -357,7 +374,6 @@ bool CICalendarProperty::Parse(cdstring& data)
 
 				// Now add attribute value
 				CICalendarAttribute attrvalue(attribute_name.get(), attribute_value.get());
-				mAttributes.insert(CICalendarAttributeMap::value_type(attrvalue.GetName(), attrvalue));
 
 				// Look for additional values
 				while(*p == ',')
@@ -367,10 +383,21 @@ bool CICalendarProperty::Parse(cdstring& data)
 					if (attribute_value2.get() != NULL)
 						attrvalue.AddValue(attribute_value2.get());
 				}
+
+				// Add once complete so that additional values are kept
+				mAttributes.insert(attrvalue);
 			}
 			break;
 		case ':':
-			CreateValue(p + 1);
+			if (lazy)
+			{
+				delete mValue;
+				mValue = NULL;
+				mRawValue = p + 1;
+				mHasRawValue = true;
+			}
+			else
+				CreateValue(p + 1);
 			done = true;
 			break;
 		default:;
@@ -378,7 +405,15 @@ bool CICalendarProperty::Parse(cdstring& data)
 	}
 	
 	// We must have a value of some kind
-	return (mValue != NULL);
+	return (mValue != NULL) || mHasRawValue;
+}
+
+// Readers of the same property can get here at the same time so only the first one decodes
+void CICalendarProperty::DecodeRawValue()
+{
+	CICalendarMutex::StLock lock(GetPropertyMutex());
+	if (mValue == NULL)
+		CreateValue(mRawValue.c_str());
 }
 
 void CICalendarProperty::CreateValue(const char* data)
@@ -395,26 +430,27 @@ void CICalendarProperty::CreateValue(const char* data)
 		type = (*found).second;
 
 	// Check whether custom value is set
-	if (mAttributes.count(cICalAttribute_VALUE))
+	if (HasAttribute(CICalendarAttribute::eVALUE))
 	{
-		CValueTypeMap::const_iterator found = sValueTypeMap.find(GetAttributeValue(cICalAttribute_VALUE));
+		CValueTypeMap::const_iterator found = sValueTypeMap.find(GetAttributeValue(CICalendarAttribute::eVALUE));
 		if (found != sValueTypeMap.end())
 			type = (*found).second;
 	}
 
 	// Check for multivalued
+	CICalendarValue* value;
 	if (sMultiValues.count(mName))
 	{
-		mValue = new CICalendarMultiValue(type);
+		value = new CICalendarMultiValue(type);
 	}
 	else
 	{
 		// Create the type
-		mValue = CICalendarValue::CreateFromType(type);
+		value = CICalendarValue::CreateFromType(type);
 	}
 
 	// Now parse the data
-	mValue->Parse(data);
+	value->Parse(data);
 
 	// Special post-create for some types
 	switch(type)
@@ -424,16 +460,16 @@ void CICalendarProperty::CreateValue(const char* data)
 	{
 		// Look for TZID attribute
 		cdstring tzid;
-		if (HasAttribute(cICalAttribute_TZID))
+		if (HasAttribute(CICalendarAttribute::eTZID))
 		{
-			tzid = GetAttributeValue(cICalAttribute_TZID);
+			tzid = GetAttributeValue(CICalendarAttribute::eTZID);
 		}
 		
-		if (dynamic_cast<CICalendarDateTimeValue*>(mValue) != NULL)
-			static_cast<CICalendarDateTimeValue*>(mValue)->GetValue().GetTimezone().SetTimezoneID(tzid);
-		else if (dynamic_cast<CICalendarMultiValue*>(mValue) != NULL)
+		if (dynamic_cast<CICalendarDateTimeValue*>(value) != NULL)
+			static_cast<CICalendarDateTimeValue*>(value)->GetValue().GetTimezone().SetTimezoneID(tzid);
+		else if (dynamic_cast<CICalendarMultiValue*>(value) != NULL)
 		{
-			for(CICalendarValueList::iterator iter = static_cast<CICalendarMultiValue*>(mValue)->GetValues().begin(); iter != static_cast<CICalendarMultiValue*>(mValue)->GetValues().end(); iter++)
+			for(CICalendarValueList::iterator iter = static_cast<CICalendarMultiValue*>(value)->GetValues().begin(); iter != static_cast<CICalendarMultiValue*>(value)->GetValues().end(); iter++)
 			{
 				if (dynamic_cast<CICalendarDateTimeValue*>(*iter) != NULL)
 					static_cast<CICalendarDateTimeValue*>(*iter)->GetValue().GetTimezone().SetTimezoneID(tzid);
@@ -443,13 +479,16 @@ void CICalendarProperty::CreateValue(const char* data)
 	}
 	default:;
 	}
+
+	// Only visible to lazy readers once complete
+	CICalendarMutex::StoreRelease(mValue, value);
 }
 
 // Make sure current VALUE= attribute matches the actual data we have
 // or is absent if default value
 void CICalendarProperty::SetupValueAttribute()
 {
-	mAttributes.erase(cICalAttribute_VALUE);
+	mAttributes.erase(CICalendarAttribute::eVALUE);
 
 	// Only if we have a value right now
 	if (mValue == NULL)
@@ -466,7 +505,7 @@ void CICalendarProperty::SetupValueAttribute()
 			CTypeValueMap::const_iterator found2 = sTypeValueMap.find(mValue->GetType());
 			if (found2 != sTypeValueMap.end())
 			{
-				mAttributes.insert(CICalendarAttributeMap::value_type(cICalAttribute_VALUE, CICalendarAttribute(cICalAttribute_VALUE, (*found2).second)));
+				mAttributes.insert(CICalendarAttribute(CICalendarAttribute::eVALUE, (*found2).second));
 			}
 		}
 	}
@@ -474,55 +513,40 @@ void CICalendarProperty::SetupValueAttribute()
 
 void CICalendarProperty::Generate(std::ostream& os) const
 {
-	const_cast<CICalendarProperty*>(this)->SetupValueAttribute();
+	// Write directly when already going to a reusable buffer, otherwise use a temporary one
+	CICalendarOutputBuffer* buffer = dynamic_cast<CICalendarOutputBuffer*>(os.rdbuf());
+	if (buffer == NULL)
+	{
+		CICalendarOutputBuffer temp(os, 0);
+		std::ostream tos(&temp);
+		Generate(tos);
+		return;
+	}
 
-	// Must write to temp buffer and then wrap
-	std::ostrstream sout;
-	
-	sout << mName;
+	// Values not changed since they were read lazily are written back as they were
+	if (!mHasRawValue)
+		const_cast<CICalendarProperty*>(this)->SetupValueAttribute();
+
+	// Whole line is folded once it has been written
+	buffer->BeginLine();
+
+	os << mName;
 
 	// Write all attributes
 	for(CICalendarAttributeMap::const_iterator iter = mAttributes.begin(); iter != mAttributes.end(); iter++)
 	{
-		sout << ";";
-		(*iter).second.Generate(sout);
+		os << ";";
+		(*iter).Generate(os);
 	}
 
 	// Write value
-	sout << ":";
-	if (mValue)
-		mValue->Generate(sout);
-	
-	sout << std::ends;
-	cdstring temp;
-	temp.steal(sout.str());
-	if (temp.length() < 75)
-		os << temp.c_str();
-	else
-	{
-		const char* p = temp.c_str();
-		const char* q = p + temp.length();
-		while(p < q)
-		{
-			if (p != temp.c_str())
-			{
-				os << net_endl << " ";
-			}
+	os << ":";
+	if (mHasRawValue)
+		os << mRawValue;
+	else if (mValue)
+		mValue->Generate(os);
 
-			int bytes = q - p;
-			if (bytes > 74)
-			{
-				bytes = 74;
-				
-				// Make sure we do not split in the middle of a utf-8 multi-octet sequence
-				unsigned char* up = (unsigned char*) p;
-				while((up[bytes] > 0x7F) && ((up[bytes] & 0xC0) == 0x80))
-					bytes--;
-			}
-			os.write(p, bytes);
-			p += bytes;
-		}
-	}
+	buffer->EndLine();
 
 	os << net_endl;
 }
@@ -25,6 +25,7 @@
 #define CICalendarProperty_H
 
 #include "CICalendarAttribute.h"
+#include "CICalendarMutex.h"
 #include "CICalendarValue.h"
 
 #include <stdint.h>
@@ -61,19 +62,19 @@ public:
 	CICalendarProperty()
 		{ _init_CICalendarProperty(); }
 	CICalendarProperty(const cdstring& name, const int32_t& int_value)
-		{ mName = name; _init_attr_value(int_value); }
+		{ _init_CICalendarProperty(); mName = name; _init_attr_value(int_value); }
 	CICalendarProperty(const cdstring& name, const cdstring& text_value, CICalendarValue::EICalValueType value_type = CICalendarValue::eValueType_Text)
-		{ mName = name; _init_attr_value(text_value, value_type); }
+		{ _init_CICalendarProperty(); mName = name; _init_attr_value(text_value, value_type); }
 	CICalendarProperty(const cdstring& name, const CICalendarDateTime& dt)
-		{ mName = name; _init_attr_value(dt); }
+		{ _init_CICalendarProperty(); mName = name; _init_attr_value(dt); }
 	CICalendarProperty(const cdstring& name, const CICalendarDateTimeList& dtl)
-		{ mName = name; _init_attr_value(dtl); }
+		{ _init_CICalendarProperty(); mName = name; _init_attr_value(dtl); }
 	CICalendarProperty(const cdstring& name, const CICalendarDuration& du)
-		{ mName = name; _init_attr_value(du); }
+		{ _init_CICalendarProperty(); mName = name; _init_attr_value(du); }
 	CICalendarProperty(const cdstring& name, const CICalendarPeriod& pe)
-		{ mName = name; _init_attr_value(pe); }
+		{ _init_CICalendarProperty(); mName = name; _init_attr_value(pe); }
 	CICalendarProperty(const cdstring& name, const CICalendarRecurrence& recur)
-		{ mName = name; _init_attr_value(recur); }
+		{ _init_CICalendarProperty(); mName = name; _init_attr_value(recur); }
 	CICalendarProperty(const CICalendarProperty& copy)
 		{ _init_CICalendarProperty(); _copy_CICalendarProperty(copy); }
 	virtual ~CICalendarProperty()
@@ -97,20 +98,29 @@ public:
 		{ mAttributes = attributes; }
 	bool HasAttribute(const cdstring& attr) const
 	{
-		return mAttributes.count(attr) != 0;
+		return mAttributes.find(attr) != mAttributes.end();
+	}
+	bool HasAttribute(CICalendarAttribute::EAttributeKey attr) const
+	{
+		return mAttributes.find(attr) != mAttributes.end();
 	}
 	const cdstring& GetAttributeValue(const cdstring& attr) const
 	{
-		return (*mAttributes.find(attr)).second.GetFirstValue();
+		return (*mAttributes.find(attr)).GetFirstValue();
+	}
+	const cdstring& GetAttributeValue(CICalendarAttribute::EAttributeKey attr) const
+	{
+		return (*mAttributes.find(attr)).GetFirstValue();
 	}
 
 	void AddAttribute(const CICalendarAttribute& attr);
 	void RemoveAttributes(const cdstring& attr);
 
+	// Caller may change the value so it can no longer be written back as it was read
 	CICalendarValue* GetValue()
-		{ return mValue; }
+		{ DecodeValue(); mHasRawValue = false; mRawValue = cdstring::null_str; return mValue; }
 	const CICalendarValue* GetValue() const
-		{ return mValue; }
+		{ DecodeValue(); return mValue; }
 
 	const CICalendarCalAddressValue* GetCalAddressValue() const;
 	const CICalendarDateTimeValue* GetDateTimeValue() const;
@@ -123,13 +133,16 @@ public:
 	const CICalendarURIValue* GetURIValue() const;
 	const CICalendarUTCOffsetValue* GetUTCOffsetValue() const;
 
-	bool Parse(cdstring& data);
+	// Lazy parsing keeps the value text and only creates the value when first used
+	bool Parse(cdstring& data, bool lazy = false);
 	void Generate(std::ostream& os) const;
 
 protected:
 	cdstring						mName;
 	CICalendarAttributeMap			mAttributes;
 	CICalendarValue*				mValue;
+	cdstring						mRawValue;
+	bool							mHasRawValue;
 
 	typedef std::map<cdstring, CICalendarValue::EICalValueType>	CValueTypeMap;
 	static CValueTypeMap		sDefaultValueTypeMap;
@@ -143,13 +156,23 @@ protected:
 
 private:
 	void _init_CICalendarProperty()
-		{ mValue = NULL; }
+		{ mValue = NULL; mHasRawValue = false; }
 	void _copy_CICalendarProperty(const CICalendarProperty& copy)
-		{ _tidy_CICalendarProperty(); mName = copy.mName; mAttributes = copy.mAttributes; mValue = copy.mValue->clone(); }
+		{
+			_tidy_CICalendarProperty();
+			mName = copy.mName;
+			mAttributes = copy.mAttributes;
+			mValue = (copy.mValue != NULL) ? copy.mValue->clone() : NULL;
+			mRawValue = copy.mRawValue;
+			mHasRawValue = copy.mHasRawValue;
+		}
 	void _tidy_CICalendarProperty()
 		{ delete mValue; mValue = NULL; }
 	void _init_map();
 
+	void DecodeValue() const
+		{ if ((CICalendarMutex::LoadAcquire(mValue) == NULL) && mHasRawValue) const_cast<CICalendarProperty*>(this)->DecodeRawValue(); }
+	void DecodeRawValue();
 	void CreateValue(const char* data);
 	void SetupValueAttribute();
 
@@ -164,7 +187,6 @@ private:
 	void _init_attr_value(const CICalendarRecurrence& recur);
 };
 
-typedef std::multimap<cdstring, CICalendarProperty> CICalendarPropertyMap;
 typedef std::vector<CICalendarProperty> CICalendarPropertyList;
 
 }	// namespace iCal
@@ -0,0 +1,286 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+	CICalendarPropertyMap.cpp
+
+	Author:
+	Description:	flat property store with a multimap style interface
+*/
+
+#include "CICalendarPropertyMap.h"
+
+#include "CICalendarMutex.h"
+
+#include <cstring>
+#include <map>
+
+using namespace iCal;
+
+// Must match the order of EPropertyKey
+static const char* cKnownNames[CICalendarPropertyMap::eKnownCount] =
+{
+	"ACTION",
+	"ATTACH",
+	"ATTENDEE",
+	"CALSCALE",
+	"CATEGORIES",
+	"CLASS",
+	"COMMENT",
+	"COMPLETED",
+	"CONTACT",
+	"CREATED",
+	"DESCRIPTION",
+	"DTEND",
+	"DTSTAMP",
+	"DTSTART",
+	"DUE",
+	"DURATION",
+	"EXDATE",
+	"EXRULE",
+	"FREEBUSY",
+	"GEO",
+	"LAST-MODIFIED",
+	"LOCATION",
+	"METHOD",
+	"ORGANIZER",
+	"PERCENT-COMPLETE",
+	"PRIORITY",
+	"PRODID",
+	"RDATE",
+	"RECURRENCE-ID",
+	"RELATED-TO",
+	"REPEAT",
+	"REQUEST-STATUS",
+	"RESOURCES",
+	"RRULE",
+	"SEQUENCE",
+	"STATUS",
+	"SUMMARY",
+	"TRANSP",
+	"TRIGGER",
+	"TZID",
+	"TZNAME",
+	"TZOFFSETFROM",
+	"TZOFFSETTO",
+	"TZURL",
+	"UID",
+	"URL",
+	"VERSION"
+};
+
+typedef std::map<cdstring, uint32_t> CNameKeys;
+
+// Function statics so that these are available during static initialisation
+static CNameKeys& GetInternedKeys()
+{
+	static CNameKeys sKeys;
+	return sKeys;
+}
+
+static CICalendarMutex& GetInternedKeysMutex()
+{
+	static CICalendarMutex sMutex;
+	return sMutex;
+}
+
+uint32_t CICalendarPropertyMap::GetKey(const char* name)
+{
+	uint32_t key;
+	if (FindKey(name, key))
+		return key;
+
+	// Add new entry unless another thread just did
+	CICalendarMutex::StLock lock(GetInternedKeysMutex());
+	if (FindKey(name, key))
+		return key;
+	CNameKeys& keys = GetInternedKeys();
+	key = eKnownCount + keys.size();
+	keys.insert(CNameKeys::value_type(name, key));
+
+	return key;
+}
+
+// Returns false for a name that has never been added to any map
+bool CICalendarPropertyMap::FindKey(const char* name, uint32_t& key)
+{
+	// Binary search on known names
+	uint32_t lo = 0;
+	uint32_t hi = eKnownCount;
+	while(lo < hi)
+	{
+		uint32_t mid = (lo + hi) / 2;
+		int result = ::strcmp(cKnownNames[mid], name);
+		if (result == 0)
+		{
+			key = mid;
+			return true;
+		}
+		else if (result < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	CICalendarMutex::StLock lock(GetInternedKeysMutex());
+	const CNameKeys& keys = GetInternedKeys();
+	CNameKeys::const_iterator found = keys.find(name);
+	if (found == keys.end())
+		return false;
+
+	key = (*found).second;
+	return true;
+}
+
+// Same ordering as comparing the names
+int CICalendarPropertyMap::CompareKey(const SEntry& entry, uint32_t key, const char* name)
+{
+	if (entry.mKey == key)
+		return 0;
+	else if ((entry.mKey < eKnownCount) && (key < eKnownCount))
+		return (entry.mKey < key) ? -1 : 1;
+	else
+		return ::strcmp((*entry.mItem).first.c_str(), name);
+}
+
+CICalendarPropertyMap::iterator CICalendarPropertyMap::insert(const value_type& value)
+{
+	SEntry entry;
+	entry.mKey = GetKey(value.first.c_str());
+
+	// Insert after any with the same name
+	uint32_t lo = 0;
+	uint32_t hi = mEntries.size();
+	while(lo < hi)
+	{
+		uint32_t mid = (lo + hi) / 2;
+		if (CompareKey(mEntries[mid], entry.mKey, value.first.c_str()) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	CAllocator allocator;
+	entry.mItem = allocator.allocate(1);
+	allocator.construct(entry.mItem, value);
+
+	return iterator(mEntries.insert(mEntries.begin() + lo, entry));
+}
+
+CICalendarPropertyMap::size_type CICalendarPropertyMap::erase(const char* name)
+{
+	std::pair<size_t, size_t> range = Range(name);
+
+	CAllocator allocator;
+	for(size_t i = range.first; i < range.second; i++)
+	{
+		allocator.destroy(mEntries[i].mItem);
+		allocator.deallocate(mEntries[i].mItem, 1);
+	}
+	mEntries.erase(mEntries.begin() + range.first, mEntries.begin() + range.second);
+
+	return range.second - range.first;
+}
+
+void CICalendarPropertyMap::erase(iterator pos)
+{
+	CAllocator allocator;
+	allocator.destroy((*pos.mIter).mItem);
+	allocator.deallocate((*pos.mIter).mItem, 1);
+	mEntries.erase(pos.mIter);
+}
+
+CICalendarPropertyMap::iterator CICalendarPropertyMap::find(const char* name)
+{
+	std::pair<size_t, size_t> range = Range(name);
+	return (range.first != range.second) ? iterator(mEntries.begin() + range.first) : end();
+}
+
+CICalendarPropertyMap::const_iterator CICalendarPropertyMap::find(const char* name) const
+{
+	std::pair<size_t, size_t> range = Range(name);
+	return (range.first != range.second) ? const_iterator(mEntries.begin() + range.first) : end();
+}
+
+CICalendarPropertyMap::size_type CICalendarPropertyMap::count(const char* name) const
+{
+	std::pair<size_t, size_t> range = Range(name);
+	return range.second - range.first;
+}
+
+std::pair<CICalendarPropertyMap::iterator, CICalendarPropertyMap::iterator> CICalendarPropertyMap::equal_range(const char* name)
+{
+	std::pair<size_t, size_t> range = Range(name);
+	return std::pair<iterator, iterator>(iterator(mEntries.begin() + range.first), iterator(mEntries.begin() + range.second));
+}
+
+std::pair<CICalendarPropertyMap::const_iterator, CICalendarPropertyMap::const_iterator> CICalendarPropertyMap::equal_range(const char* name) const
+{
+	std::pair<size_t, size_t> range = Range(name);
+	return std::pair<const_iterator, const_iterator>(const_iterator(mEntries.begin() + range.first), const_iterator(mEntries.begin() + range.second));
+}
+
+// Indexes of the first and one past the last entry with the name
+std::pair<size_t, size_t> CICalendarPropertyMap::Range(const char* name) const
+{
+	uint32_t key;
+	if (mEntries.empty() || !FindKey(name, key))
+		return std::pair<size_t, size_t>(0, 0);
+
+	// Lower bound
+	size_t lo = 0;
+	size_t hi = mEntries.size();
+	while(lo < hi)
+	{
+		size_t mid = (lo + hi) / 2;
+		if (CompareKey(mEntries[mid], key, name) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	// Usually only a few with the same name so just step over them
+	size_t last = lo;
+	while((last < mEntries.size()) && (mEntries[last].mKey == key))
+		last++;
+
+	return std::pair<size_t, size_t>(lo, last);
+}
+
+void CICalendarPropertyMap::_copy_CICalendarPropertyMap(const CICalendarPropertyMap& copy)
+{
+	CAllocator allocator;
+	mEntries.reserve(copy.mEntries.size());
+	for(CEntries::const_iterator iter = copy.mEntries.begin(); iter != copy.mEntries.end(); iter++)
+	{
+		SEntry entry;
+		entry.mKey = (*iter).mKey;
+		entry.mItem = allocator.allocate(1);
+		allocator.construct(entry.mItem, *(*iter).mItem);
+		mEntries.push_back(entry);
+	}
+}
+
+void CICalendarPropertyMap::_tidy_CICalendarPropertyMap()
+{
+	CAllocator allocator;
+	for(CEntries::const_iterator iter = mEntries.begin(); iter != mEntries.end(); iter++)
+	{
+		allocator.destroy((*iter).mItem);
+		allocator.deallocate((*iter).mItem, 1);
+	}
+	mEntries.clear();
+}
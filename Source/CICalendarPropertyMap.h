@@ -0,0 +1,253 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+	CICalendarPropertyMap.h
+
+	Author:
+	Description:	flat property store with a multimap style interface
+*/
+
+#ifndef CICalendarPropertyMap_H
+#define CICalendarPropertyMap_H
+
+#include "CICalendarArena.h"
+#include "CICalendarProperty.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "cdstring.h"
+
+namespace iCal {
+
+// Properties are kept in a vector of (key, property) entries sorted the same way as
+// std::multimap<cdstring, CICalendarProperty> would sort them. Known property names have
+// keys that sort the same way as the names, so most compares are integer compares. X- and
+// IANA names get interned keys after those and fall back to comparing names.
+
+class CICalendarPropertyMap
+{
+public:
+	// Known property names in the same order as the names sort
+	enum EPropertyKey
+	{
+		eACTION,
+		eATTACH,
+		eATTENDEE,
+		eCALSCALE,
+		eCATEGORIES,
+		eCLASS,
+		eCOMMENT,
+		eCOMPLETED,
+		eCONTACT,
+		eCREATED,
+		eDESCRIPTION,
+		eDTEND,
+		eDTSTAMP,
+		eDTSTART,
+		eDUE,
+		eDURATION,
+		eEXDATE,
+		eEXRULE,
+		eFREEBUSY,
+		eGEO,
+		eLAST_MODIFIED,
+		eLOCATION,
+		eMETHOD,
+		eORGANIZER,
+		ePERCENT_COMPLETE,
+		ePRIORITY,
+		ePRODID,
+		eRDATE,
+		eRECURRENCE_ID,
+		eRELATED_TO,
+		eREPEAT,
+		eREQUEST_STATUS,
+		eRESOURCES,
+		eRRULE,
+		eSEQUENCE,
+		eSTATUS,
+		eSUMMARY,
+		eTRANSP,
+		eTRIGGER,
+		eTZID,
+		eTZNAME,
+		eTZOFFSETFROM,
+		eTZOFFSETTO,
+		eTZURL,
+		eUID,
+		eURL,
+		eVERSION,
+
+		// Interned names start here
+		eKnownCount
+	};
+
+	typedef cdstring									key_type;
+	typedef CICalendarProperty							mapped_type;
+	typedef std::pair<const cdstring, CICalendarProperty>	value_type;
+	typedef size_t										size_type;
+
+private:
+	struct SEntry
+	{
+		uint32_t	mKey;
+		value_type*	mItem;
+	};
+	typedef std::vector<SEntry> CEntries;
+
+public:
+	class const_iterator;
+
+	class iterator
+	{
+	public:
+		iterator() {}
+		explicit iterator(CEntries::iterator iter)
+			: mIter(iter) {}
+
+		value_type& operator*() const
+			{ return *(*mIter).mItem; }
+		value_type* operator->() const
+			{ return (*mIter).mItem; }
+
+		iterator& operator++()
+			{ ++mIter; return *this; }
+		iterator operator++(int)
+			{ iterator temp(*this); ++mIter; return temp; }
+		iterator& operator--()
+			{ --mIter; return *this; }
+		iterator operator--(int)
+			{ iterator temp(*this); --mIter; return temp; }
+
+		bool operator==(const iterator& comp) const
+			{ return mIter == comp.mIter; }
+		bool operator!=(const iterator& comp) const
+			{ return mIter != comp.mIter; }
+
+	private:
+		friend class CICalendarPropertyMap;
+		friend class const_iterator;
+
+		CEntries::iterator	mIter;
+	};
+
+	class const_iterator
+	{
+	public:
+		const_iterator() {}
+		explicit const_iterator(CEntries::const_iterator iter)
+			: mIter(iter) {}
+		const_iterator(const iterator& iter)
+			: mIter(iter.mIter) {}
+
+		const value_type& operator*() const
+			{ return *(*mIter).mItem; }
+		const value_type* operator->() const
+			{ return (*mIter).mItem; }
+
+		const_iterator& operator++()
+			{ ++mIter; return *this; }
+		const_iterator operator++(int)
+			{ const_iterator temp(*this); ++mIter; return temp; }
+		const_iterator& operator--()
+			{ --mIter; return *this; }
+		const_iterator operator--(int)
+			{ const_iterator temp(*this); --mIter; return temp; }
+
+		bool operator==(const const_iterator& comp) const
+			{ return mIter == comp.mIter; }
+		bool operator!=(const const_iterator& comp) const
+			{ return mIter != comp.mIter; }
+
+	private:
+		CEntries::const_iterator	mIter;
+	};
+
+	CICalendarPropertyMap() {}
+	CICalendarPropertyMap(const CICalendarPropertyMap& copy)
+		{ _copy_CICalendarPropertyMap(copy); }
+	~CICalendarPropertyMap()
+		{ _tidy_CICalendarPropertyMap(); }
+
+	CICalendarPropertyMap& operator=(const CICalendarPropertyMap& copy)
+		{ if (this != &copy) { _tidy_CICalendarPropertyMap(); _copy_CICalendarPropertyMap(copy); } return *this; }
+
+	// Key for a name - X- and IANA names are interned on first use
+	static uint32_t GetKey(const char* name);
+
+	iterator begin()
+		{ return iterator(mEntries.begin()); }
+	const_iterator begin() const
+		{ return const_iterator(mEntries.begin()); }
+	iterator end()
+		{ return iterator(mEntries.end()); }
+	const_iterator end() const
+		{ return const_iterator(mEntries.end()); }
+
+	bool empty() const
+		{ return mEntries.empty(); }
+	size_type size() const
+		{ return mEntries.size(); }
+
+	// Equal names are kept in the order they were added
+	iterator insert(const value_type& value);
+
+	size_type erase(const char* name);
+	size_type erase(const cdstring& name)
+		{ return erase(name.c_str()); }
+	void erase(iterator pos);
+	void clear()
+		{ _tidy_CICalendarPropertyMap(); }
+
+	iterator find(const char* name);
+	const_iterator find(const char* name) const;
+	iterator find(const cdstring& name)
+		{ return find(name.c_str()); }
+	const_iterator find(const cdstring& name) const
+		{ return find(name.c_str()); }
+
+	size_type count(const char* name) const;
+	size_type count(const cdstring& name) const
+		{ return count(name.c_str()); }
+
+	std::pair<iterator, iterator> equal_range(const char* name);
+	std::pair<const_iterator, const_iterator> equal_range(const char* name) const;
+	std::pair<iterator, iterator> equal_range(const cdstring& name)
+		{ return equal_range(name.c_str()); }
+	std::pair<const_iterator, const_iterator> equal_range(const cdstring& name) const
+		{ return equal_range(name.c_str()); }
+
+private:
+	typedef CICalendarArenaAllocator<value_type> CAllocator;
+
+	CEntries	mEntries;
+
+	static bool	FindKey(const char* name, uint32_t& key);
+	static int	CompareKey(const SEntry& entry, uint32_t key, const char* name);
+
+	std::pair<size_t, size_t>	Range(const char* name) const;
+
+	void	_copy_CICalendarPropertyMap(const CICalendarPropertyMap& copy);
+	void	_tidy_CICalendarPropertyMap();
+};
+
+}	// namespace iCal
+
+#endif	// CICalendarPropertyMap_H
@@ -24,6 +24,7 @@
 #include "CICalendarRecurrence.h"
 
 #include "CICalendarPeriod.h"
+#include "CICalendarUtils.h"
 #include "CStringUtils.h"
 
 #include <cerrno>
@@ -82,8 +83,10 @@ void CICalendarRecurrence::_copy_CICalendarRecurrence(const CICalendarRecurrence
 	mBySetPos = copy.mBySetPos;
 	mWeekstart = copy.mWeekstart;
 
+	CICalendarMutex::StLock lock(copy.mCacheMutex);
 	mCached = copy.mCached;
 	mCacheStart = copy.mCacheStart;
+	mCacheFrom = copy.mCacheFrom;
 	mCacheUpto = copy.mCacheUpto;
 	mFullyCached = copy.mFullyCached;
 	mRecurrences = copy.mRecurrences;
@@ -607,10 +610,16 @@ cdstring CICalendarRecurrence::GetUIDescription() const
 	return temp;
 }
 
-void CICalendarRecurrence::Expand(const CICalendarDateTime& start, const CICalendarPeriod& range, CICalendarDateTimeList& items) const
+bool CICalendarRecurrence::Expand(const CICalendarDateTime& start, const CICalendarPeriod& range, CICalendarDateTimeList& items) const
 {
-	// Wipe cache if start is different
-	if (mCached && (start != mCacheStart))
+	CICalendarMutex::StLock lock(mCacheMutex);
+
+	// Wipe cache if start is different, including its timezone as cached items are all in that timezone,
+	// or if the range starts before the cached items
+	if (mCached && ((start != mCacheStart) ||
+					(start.GetTimezone().GetUTC() != mCacheStart.GetTimezone().GetUTC()) ||
+					(start.GetTimezone().GetTimezoneHandle() != mCacheStart.GetTimezone().GetTimezoneHandle()) ||
+					(range.GetStart() < mCacheFrom)))
 	{
 		mCached = false;
 		mFullyCached = false;
@@ -635,32 +644,58 @@ void CICalendarRecurrence::Expand(const CICalendarDateTime& start, const CICalen
 			mFullyCached = ComplexExpand(start, cache_range, mRecurrences);
 		
 		// Set cache values
+		if (!mCached)
+			mCacheFrom = range.GetStart();
 		mCached = true;
 		mCacheStart = start;
 		mCacheUpto = range.GetEnd();
 	}
 	
 	// Just return the cached items in the requested range
-	for(CICalendarDateTimeList::const_iterator iter = mRecurrences.begin(); iter != mRecurrences.end(); iter++)
+	if ((range.GetStart().GetTimezone() == start.GetTimezone()) && (range.GetEnd().GetTimezone() == start.GetTimezone()))
 	{
-		if (range.IsDateWithinPeriod(*iter))
-			items.push_back(*iter);
+		// Same timezone as the cached items so compare in packed form
+		CICalendarPackedDateTime range_start(range.GetStart());
+		CICalendarPackedDateTime range_end(range.GetEnd());
+		for(CICalendarPackedDateTimeList::const_iterator iter = mRecurrences.begin(); iter != mRecurrences.end(); iter++)
+		{
+			// Inclusive start, exclusive end
+			if (((*iter).Compare(range_start) >= 0) && ((*iter).Compare(range_end) < 0))
+				items.push_back((*iter).GetDateTime());
+		}
 	}
+	else
+	{
+		for(CICalendarPackedDateTimeList::const_iterator iter = mRecurrences.begin(); iter != mRecurrences.end(); iter++)
+		{
+			CICalendarDateTime temp((*iter).GetDateTime());
+			if (range.IsDateWithinPeriod(temp))
+				items.push_back(temp);
+		}
+	}
+
+	// Whole rule is cached and the last one is before the end
+	return mFullyCached && (mRecurrences.empty() || (mRecurrences.back().CompareDateTime(CICalendarPackedDateTime(range.GetEnd())) < 0));
 }
 
-bool CICalendarRecurrence::SimpleExpand(const CICalendarDateTime& start, const CICalendarPeriod& range, CICalendarDateTimeList& items) const
+bool CICalendarRecurrence::SimpleExpand(const CICalendarDateTime& start, const CICalendarPeriod& range, CICalendarPackedDateTimeList& items) const
 {
 	CICalendarDateTime start_iter(start);
 	int32_t ctr = 0;
 
+	// Jump to the last instance well before the range
+	if (SkipAhead(start_iter, range.GetStart(), ctr) && mUseUntil && (start_iter > mUntil))
+		return true;
+
 	while(true)
 	{
 		// Exit if after period we want
 		if (range.IsDateAfterPeriod(start_iter))
 			return false;
 
-		// Add current one to list
-		items.push_back(start_iter);
+		// Add current one to list if not before the period
+		if (!range.IsDateBeforePeriod(start_iter))
+			items.push_back(CICalendarPackedDateTime(start_iter));
 		
 		// Get next item
 		start_iter.Recur(mFreq, mInterval);
@@ -683,13 +718,15 @@ bool CICalendarRecurrence::SimpleExpand(const CICalendarDateTime& start, const C
 	}
 }
 
-bool CICalendarRecurrence::ComplexExpand(const CICalendarDateTime& start, const CICalendarPeriod& range, CICalendarDateTimeList& items) const
+bool CICalendarRecurrence::ComplexExpand(const CICalendarDateTime& start, const CICalendarPeriod& range, CICalendarPackedDateTimeList& items) const
 {
 	CICalendarDateTime start_iter(start);
 	int32_t ctr = 0;
+	bool skipped = false;
 
 	// Always add the initial instance DTSTART
-	items.push_back(start);
+	if (!range.IsDateBeforePeriod(start))
+		items.push_back(CICalendarPackedDateTime(start));
 	if (mUseCount)
 	{
 		// Bump counter and exit if over
@@ -757,8 +794,9 @@ bool CICalendarRecurrence::ComplexExpand(const CICalendarDateTime& start, const
 			if ((ctr == 1) && (start == *iter))
 				continue;
 
-			// Add current one to list
-			items.push_back(*iter);
+			// Add current one to list if not before the period
+			if (!range.IsDateBeforePeriod(*iter))
+				items.push_back(CICalendarPackedDateTime(*iter));
 			
 			// Check limits
 			if (mUseCount)
@@ -773,12 +811,179 @@ bool CICalendarRecurrence::ComplexExpand(const CICalendarDateTime& start, const
 		// Exit if after period we want
 		if (range.IsDateAfterPeriod(start_iter))
 			return false;
+
+		// Once past the first set jump over the sets well before the period
+		if (!skipped)
+		{
+			SkipAhead(start_iter, range.GetStart(), ctr);
+			skipped = true;
+		}
 		
 		// Get next item
 		start_iter.Recur(mFreq, mInterval);
 	}
 }
 
+// Rules where the number of instances in each set is known without generating it
+bool CICalendarRecurrence::CanSkipAhead(const CICalendarDateTime& start) const
+{
+	if (!HasBy())
+	{
+		switch(mFreq)
+		{
+		case eRecurrence_SECONDLY:
+		case eRecurrence_MINUTELY:
+		case eRecurrence_HOURLY:
+			// Date only values do not move
+			return !start.IsDateOnly();
+		case eRecurrence_YEARLY:
+			// 29 February moves to 1 March after the first year
+			return (start.GetMonth() != 2) || (start.GetDay() != 29);
+		default:
+			return true;
+		}
+	}
+
+	// Only BYDAY on its own
+	if (mByDay.empty() || !mBySeconds.empty() || !mByMinutes.empty() || !mByHours.empty() ||
+		!mByMonthDay.empty() || !mByYearDay.empty() || !mByWeekNo.empty() || !mByMonth.empty() || !mBySetPos.empty())
+		return false;
+
+	return (mFreq == eRecurrence_WEEKLY) || (mFreq == eRecurrence_MONTHLY);
+}
+
+// Moves start_iter on by whole sets whose instances are all before the range start, adding the number
+// of instances in the sets moved on to, to ctr. This gives the same result as calling Recur over and over
+// but without generating each set. Stops short of COUNT.
+bool CICalendarRecurrence::SkipAhead(CICalendarDateTime& start_iter, const CICalendarDateTime& range_start, int32_t& ctr) const
+{
+	if (!CanSkipAhead(start_iter))
+		return false;
+
+	// Leave the last instance for the normal COUNT check
+	int32_t max_count = mUseCount ? mCount - 1 - ctr : 0x7FFFFFFF;
+	if (max_count <= 0)
+		return false;
+
+	int32_t interval = std::max(mInterval, 1);
+	if ((mFreq == eRecurrence_MONTHLY) || (mFreq == eRecurrence_YEARLY))
+	{
+		// Stay a few months clear of the range for timezone differences and for BYDAY
+		// offsets that run into the next month
+		int32_t months = (range_start.GetYear() - start_iter.GetYear()) * 12 + range_start.GetMonth() - start_iter.GetMonth() - 3;
+		if (months <= 0)
+			return false;
+
+		if (mFreq == eRecurrence_YEARLY)
+		{
+			int32_t steps = std::min((months / 12) / interval, max_count);
+			if (steps <= 0)
+				return false;
+			start_iter.OffsetYear(steps * interval);
+			ctr += steps;
+			return true;
+		}
+
+		// Months without the day are passed over by Recur
+		int32_t year = start_iter.GetYear();
+		int32_t month = start_iter.GetMonth();
+		int32_t skip_year = year;
+		int32_t skip_month = month;
+		int32_t count = 0;
+		for(int32_t step = 0; step < months / interval; step++)
+		{
+			month += interval;
+			year += (month - 1) / 12;
+			month = ((month - 1) % 12) + 1;
+			if (start_iter.GetDay() > CICalendarUtils::DaysInMonth(month, year))
+				continue;
+
+			int32_t set_count = SetCount(year, month);
+			if (count + set_count > max_count)
+				break;
+			count += set_count;
+			skip_year = year;
+			skip_month = month;
+		}
+		if ((skip_year == start_iter.GetYear()) && (skip_month == start_iter.GetMonth()))
+			return false;
+
+		start_iter.SetYear(skip_year);
+		start_iter.SetMonth(skip_month);
+		ctr += count;
+		return true;
+	}
+
+	// Fixed length steps - stay a couple of days clear of the range for timezone differences
+	// and a week for weekly sets
+	int64_t step;
+	switch(mFreq)
+	{
+	case eRecurrence_SECONDLY:
+		step = 1;
+		break;
+	case eRecurrence_MINUTELY:
+		step = 60;
+		break;
+	case eRecurrence_HOURLY:
+		step = 60 * 60;
+		break;
+	case eRecurrence_WEEKLY:
+		step = 7 * 24 * 60 * 60;
+		break;
+	case eRecurrence_DAILY:
+	default:
+		step = 24 * 60 * 60;
+		break;
+	}
+	step *= interval;
+	int64_t margin = (mFreq == eRecurrence_WEEKLY) ? 9 * 24 * 60 * 60 : 2 * 24 * 60 * 60;
+	int64_t steps = (range_start.GetPosixTime() - start_iter.GetPosixTime() - margin) / step;
+	int32_t set_count = SetCount(start_iter.GetYear(), start_iter.GetMonth());
+	if (set_count != 0)
+		steps = std::min(steps, static_cast<int64_t>(max_count / set_count));
+	if (steps <= 0)
+		return false;
+
+	// Field arithmetic is the same as Recur and Normalise
+	int64_t offset = steps * step;
+	start_iter.OffsetDay(static_cast<int32_t>(offset / (24 * 60 * 60)));
+	start_iter.OffsetSeconds(static_cast<int32_t>(offset % (24 * 60 * 60)));
+	ctr += static_cast<int32_t>(steps) * set_count;
+	return true;
+}
+
+// Number of instances in the set for a rule that CanSkipAhead
+int32_t CICalendarRecurrence::SetCount(int32_t year, int32_t month) const
+{
+	if (!HasBy())
+		return 1;
+
+	int32_t count = 0;
+	int32_t first_day = -1;
+	for(std::vector<CWeekDayNum>::const_iterator iter = mByDay.begin(); iter != mByDay.end(); iter++)
+	{
+		if (mFreq == eRecurrence_WEEKLY)
+		{
+			// Numeric values are ignored
+			if ((*iter).first == 0)
+				count++;
+		}
+		else if ((*iter).first != 0)
+			count++;
+		else
+		{
+			// Four or five of each day in the month
+			if (first_day < 0)
+				first_day = CICalendarDateTime(year, month, 1).GetDayOfWeek();
+			int32_t offset = ((*iter).second - first_day + 7) % 7;
+			count += (offset < CICalendarUtils::DaysInMonth(month, year) - 28) ? 5 : 4;
+		}
+	}
+
+	return count;
+}
+
 // Clear out cached values due to some sort of change
 void CICalendarRecurrence::Clear()
 {
@@ -26,6 +26,8 @@
 
 #include "CICalendarDateTime.h"
 #include "CICalendarDefinitions.h"
+#include "CICalendarMutex.h"
+#include "CICalendarPackedDateTime.h"
 
 #include <map>
 #include <vector>
@@ -116,7 +118,8 @@ public:
 
 	cdstring GetUIDescription() const;
 
-	void Expand(const CICalendarDateTime& start, const CICalendarPeriod& range, CICalendarDateTimeList& items) const;
+	// Returns true if there are no more instances after the range
+	bool Expand(const CICalendarDateTime& start, const CICalendarPeriod& range, CICalendarDateTimeList& items) const;
 	void Clear();
 	void ExcludeFutureRecurrence(const CICalendarDateTime& exclude);
 
@@ -140,11 +143,14 @@ protected:
 	std::vector<int32_t>				mBySetPos;
 	ERecurrence_WEEKDAY			mWeekstart;
 
+	// Cache is filled by concurrent readers under the mutex
+	mutable CICalendarMutex				mCacheMutex;
 	mutable bool						mCached;
 	mutable CICalendarDateTime			mCacheStart;
+	mutable CICalendarDateTime			mCacheFrom;
 	mutable CICalendarDateTime			mCacheUpto;
 	mutable bool						mFullyCached;
-	mutable CICalendarDateTimeList		mRecurrences;
+	mutable CICalendarPackedDateTimeList	mRecurrences;
 
 private:
 	typedef std::map<cdstring, ERecurrence_FREQ>	CFreqMap;
@@ -159,8 +165,12 @@ private:
 	void ParseList(const char* txt, std::vector<int32_t>& list);
 	void ParseList(const char* txt, std::vector<CWeekDayNum>& list);
 
-	bool SimpleExpand(const CICalendarDateTime& start, const CICalendarPeriod& range, CICalendarDateTimeList& items) const;
-	bool ComplexExpand(const CICalendarDateTime& start, const CICalendarPeriod& range, CICalendarDateTimeList& items) const;
+	bool SimpleExpand(const CICalendarDateTime& start, const CICalendarPeriod& range, CICalendarPackedDateTimeList& items) const;
+	bool ComplexExpand(const CICalendarDateTime& start, const CICalendarPeriod& range, CICalendarPackedDateTimeList& items) const;
+
+	bool CanSkipAhead(const CICalendarDateTime& start) const;
+	bool SkipAhead(CICalendarDateTime& start_iter, const CICalendarDateTime& range_start, int32_t& ctr) const;
+	int32_t SetCount(int32_t year, int32_t month) const;
 
 	void GenerateYearlySet(const CICalendarDateTime& start, CICalendarDateTimeList& items) const;
 	void GenerateMonthlySet(const CICalendarDateTime& start, CICalendarDateTimeList& items) const;
@@ -0,0 +1,202 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+
+/*
+	CICalendarRecurrenceIterator.cpp
+
+	Author:
+	Description:	pulls the instances of a recurrence set in order
+*/
+
+#include "CICalendarRecurrenceIterator.h"
+
+#include "CICalendarRecurrence.h"
+#include "CICalendarRecurrenceSet.h"
+
+#include <algorithm>
+
+using namespace iCal;
+
+// Windows stop doubling at about 400 years
+static const int64_t cMaxWindow = 400LL * 366 * 24 * 60 * 60;
+
+// Seconds for about eight instances of the rule without any BYxxx parts
+static int64_t initial_window(const CICalendarRecurrence& rule)
+{
+	int64_t span = 24 * 60 * 60;
+	switch(rule.GetFreq())
+	{
+	case eRecurrence_SECONDLY:
+		span = 1;
+		break;
+	case eRecurrence_MINUTELY:
+		span = 60;
+		break;
+	case eRecurrence_HOURLY:
+		span = 60 * 60;
+		break;
+	case eRecurrence_DAILY:
+		span = 24 * 60 * 60;
+		break;
+	case eRecurrence_WEEKLY:
+		span = 7 * 24 * 60 * 60;
+		break;
+	case eRecurrence_MONTHLY:
+		span = 31 * 24 * 60 * 60;
+		break;
+	case eRecurrence_YEARLY:
+		span = 366 * 24 * 60 * 60;
+		break;
+	}
+
+	return std::min(span * std::max(rule.GetInterval(), 1) * 8, cMaxWindow);
+}
+
+CICalendarRecurrenceIterator::CICalendarRecurrenceIterator(const CICalendarRecurrenceSet& recurs, const CICalendarDateTime& start, const CICalendarPeriod& range)
+	: mStart(start), mRange(range)
+{
+	mHaveLast = false;
+
+	// DTSTART is always included
+	AddRules(recurs.GetRules(), mInclude);
+	AddDates(recurs.GetDates(), recurs.GetPeriods(), &start, mInclude);
+
+	AddRules(recurs.GetExrules(), mExclude);
+	AddDates(recurs.GetExdates(), recurs.GetExperiods(), NULL, mExclude);
+}
+
+bool CICalendarRecurrenceIterator::Next(CICalendarDateTime& dt)
+{
+	while(true)
+	{
+		// Earliest of all the included streams
+		SStream* next = NULL;
+		const CICalendarDateTime* next_dt = NULL;
+		for(CStreams::iterator iter = mInclude.begin(); iter != mInclude.end(); iter++)
+		{
+			const CICalendarDateTime* item = Peek(*iter);
+			if ((item != NULL) && ((next_dt == NULL) || (*item < *next_dt)))
+			{
+				next = &(*iter);
+				next_dt = item;
+			}
+		}
+		if (next == NULL)
+			return false;
+
+		dt = *next_dt;
+		next->mPos++;
+
+		// Same one may come from more than one stream
+		if (mHaveLast && !(mLast < dt))
+			continue;
+		mHaveLast = true;
+		mLast = dt;
+
+		// Move excluded streams up to this one and see if any match it
+		bool excluded = false;
+		for(CStreams::iterator iter = mExclude.begin(); iter != mExclude.end(); iter++)
+		{
+			const CICalendarDateTime* item = Peek(*iter);
+			while((item != NULL) && (*item < dt))
+			{
+				(*iter).mPos++;
+				item = Peek(*iter);
+			}
+			if ((item != NULL) && !(dt < *item))
+				excluded = true;
+		}
+
+		if (!excluded)
+			return true;
+	}
+}
+
+void CICalendarRecurrenceIterator::AddRules(const std::vector<CICalendarRecurrence>& rules, CStreams& streams)
+{
+	for(std::vector<CICalendarRecurrence>::const_iterator iter = rules.begin(); iter != rules.end(); iter++)
+	{
+		streams.push_back(SStream());
+		SStream& stream = streams.back();
+		stream.mRule = &(*iter);
+		stream.mPos = 0;
+		stream.mUpto = mRange.GetStart();
+		stream.mWindow = initial_window(*iter);
+		stream.mDone = false;
+	}
+}
+
+// Same tests as CICalendarRecurrenceSet::Expand
+void CICalendarRecurrenceIterator::AddDates(const CICalendarDateTimeList& dates, const CICalendarPeriodList& periods, const CICalendarDateTime* start, CStreams& streams)
+{
+	SStream stream;
+	stream.mRule = NULL;
+	stream.mPos = 0;
+	stream.mWindow = 0;
+	stream.mDone = true;
+
+	if ((start != NULL) && mRange.IsDateWithinPeriod(*start))
+		stream.mItems.push_back(*start);
+	for(CICalendarDateTimeList::const_iterator iter = dates.begin(); iter != dates.end(); iter++)
+	{
+		if (mRange.IsDateWithinPeriod(*iter))
+			stream.mItems.push_back(*iter);
+	}
+	for(CICalendarPeriodList::const_iterator iter = periods.begin(); iter != periods.end(); iter++)
+	{
+		if (mRange.IsPeriodOverlap(*iter))
+			stream.mItems.push_back((*iter).GetStart());
+	}
+
+	if (!stream.mItems.empty())
+	{
+		std::sort(stream.mItems.begin(), stream.mItems.end());
+		streams.push_back(stream);
+	}
+}
+
+// Current item of the stream, expanding the next window of a rule when needed
+const CICalendarDateTime* CICalendarRecurrenceIterator::Peek(SStream& stream)
+{
+	if ((stream.mPos >= stream.mItems.size()) && !stream.mDone)
+		Fill(stream);
+
+	return (stream.mPos < stream.mItems.size()) ? &stream.mItems[stream.mPos] : NULL;
+}
+
+void CICalendarRecurrenceIterator::Fill(SStream& stream)
+{
+	stream.mItems.clear();
+	stream.mPos = 0;
+
+	// Keep going until something turns up or the rule or range ends
+	while(stream.mItems.empty() && !stream.mDone)
+	{
+		CICalendarDateTime window_end(stream.mUpto);
+		window_end.OffsetDay(stream.mWindow / (24 * 60 * 60));
+		window_end.OffsetSeconds(stream.mWindow % (24 * 60 * 60));
+		if (!(window_end < mRange.GetEnd()))
+			window_end = mRange.GetEnd();
+
+		bool ended = stream.mRule->Expand(mStart, CICalendarPeriod(stream.mUpto, window_end), stream.mItems);
+		stream.mUpto = window_end;
+		stream.mDone = ended || !(stream.mUpto < mRange.GetEnd());
+		stream.mWindow = std::min(stream.mWindow * 2, cMaxWindow);
+	}
+
+	std::sort(stream.mItems.begin(), stream.mItems.end());
+}
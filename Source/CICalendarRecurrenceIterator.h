@@ -0,0 +1,87 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+
+/*
+	CICalendarRecurrenceIterator.h
+
+	Author:
+	Description:	pulls the instances of a recurrence set in order
+*/
+
+#ifndef CICalendarRecurrenceIterator_H
+#define CICalendarRecurrenceIterator_H
+
+#include "CICalendarDateTime.h"
+#include "CICalendarPeriod.h"
+
+#include <vector>
+
+namespace iCal {
+
+class CICalendarRecurrence;
+class CICalendarRecurrenceSet;
+
+// Instances of a recurrence set within a range, one at a time in order. Each RRULE and
+// EXRULE is expanded a window at a time (doubling in size) so callers that stop early only
+// pay for what they used. RRULE and RDATE streams are merged, and anything matching the
+// merged EXRULE and EXDATE streams is dropped. Gives the same instances as
+// CICalendarRecurrenceSet::Expand.
+//
+// The recurrence set must not change while the iterator is in use.
+
+class CICalendarRecurrenceIterator
+{
+public:
+	CICalendarRecurrenceIterator(const CICalendarRecurrenceSet& recurs, const CICalendarDateTime& start, const CICalendarPeriod& range);
+	~CICalendarRecurrenceIterator() {}
+
+	// Returns false when there are no more instances
+	bool Next(CICalendarDateTime& dt);
+
+private:
+	struct SStream
+	{
+		const CICalendarRecurrence*	mRule;			// NULL for fixed dates
+		CICalendarDateTimeList		mItems;
+		uint32_t					mPos;
+		CICalendarDateTime			mUpto;			// rule expanded up to here
+		int64_t						mWindow;		// seconds in next window
+		bool						mDone;
+	};
+	typedef std::vector<SStream> CStreams;
+
+	CICalendarDateTime	mStart;
+	CICalendarPeriod	mRange;
+	CStreams			mInclude;
+	CStreams			mExclude;
+	bool				mHaveLast;
+	CICalendarDateTime	mLast;
+
+	void AddRules(const std::vector<CICalendarRecurrence>& rules, CStreams& streams);
+	void AddDates(const CICalendarDateTimeList& dates, const CICalendarPeriodList& periods, const CICalendarDateTime* start, CStreams& streams);
+
+	const CICalendarDateTime* Peek(SStream& stream);
+	void Fill(SStream& stream);
+
+	// Not copyable
+	CICalendarRecurrenceIterator(const CICalendarRecurrenceIterator& copy);
+	CICalendarRecurrenceIterator& operator=(const CICalendarRecurrenceIterator& copy);
+};
+
+}	// namespace iCal
+
+#endif	// CICalendarRecurrenceIterator_H
@@ -23,6 +23,8 @@
 
 #include "CICalendarRecurrenceSet.h"
 
+#include "CICalendarRecurrenceIterator.h"
+
 #include "CStringUtils.h"
 
 #include <cerrno>
@@ -204,6 +206,26 @@ void CICalendarRecurrenceSet::Expand(const CICalendarDateTime& start, const CICa
 
 }
 
+// Only the first count instances within the range
+void CICalendarRecurrenceSet::ExpandFirst(const CICalendarDateTime& start, const CICalendarPeriod& range, uint32_t count, CICalendarDateTimeList& items) const
+{
+	CICalendarRecurrenceIterator iter(*this, start, range);
+	CICalendarDateTime dt;
+	while((count != 0) && iter.Next(dt))
+	{
+		items.push_back(dt);
+		count--;
+	}
+}
+
+// Stops at the first instance within the range
+bool CICalendarRecurrenceSet::WithinPeriod(const CICalendarDateTime& start, const CICalendarPeriod& range) const
+{
+	CICalendarRecurrenceIterator iter(*this, start, range);
+	CICalendarDateTime dt;
+	return iter.Next(dt);
+}
+
 // Recurrence set changed in some way - force reset of all cached values
 void CICalendarRecurrenceSet::Changed()
 {
@@ -76,6 +76,8 @@ public:
 		{ return mExperiods; }
 
 	void Expand(const CICalendarDateTime& start, const CICalendarPeriod& range, CICalendarDateTimeList& items) const;
+	void ExpandFirst(const CICalendarDateTime& start, const CICalendarPeriod& range, uint32_t count, CICalendarDateTimeList& items) const;
+	bool WithinPeriod(const CICalendarDateTime& start, const CICalendarPeriod& range) const;
 	void Changed();
 	void ExcludeFutureRecurrence(const CICalendarDateTime& exclude);
 
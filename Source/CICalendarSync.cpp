@@ -72,9 +72,11 @@ void CICalendarSync::Sync()
 	RemoveKeys(keyset, mCal1.GetRecording(), CICalendarComponentRecord::eAdded);
 	
 	// Step 3.2
-	for(CICalendarSyncDataList::const_iterator iter = keyset.begin(); iter != keyset.end(); iter++)
+	if (keyset.size() != 0)
 	{
-		mCal1.RemoveComponentByKey((*iter).GetMapKey());
+		cdstrvect mapkeys;
+		GetMapKeys(keyset, mapkeys);
+		mCal1.RemoveComponentsByKey(mapkeys);
 		cal1_changed = true;
 	}
 	
@@ -94,9 +96,13 @@ void CICalendarSync::Sync()
 	RemoveKeys(keyset, mCal1.GetRecording(), CICalendarComponentRecord::eRemoved | CICalendarComponentRecord::eRemovedAdded);
 
 	// Step 4.2
-	for(CICalendarSyncDataList::const_iterator iter = keyset.begin(); iter != keyset.end(); iter++)
+	cdstrvect mapkeys;
+	GetMapKeys(keyset, mapkeys);
+	CICalendarConstComponentList comps;
+	mCal2.GetComponentsByKey(mapkeys, comps);
+	for(CICalendarConstComponentList::const_iterator iter = comps.begin(); iter != comps.end(); iter++)
 	{
-		const CICalendarComponent* comp = mCal2.GetComponentByKey((*iter).GetMapKey());
+		const CICalendarComponent* comp = *iter;
 		if (comp != NULL)
 		{
 			CICalendarComponent* new_comp = comp->clone();
@@ -260,6 +266,14 @@ void CICalendarSync::GetKeys(const CICalendarComponentDB& db, CICalendarSyncData
 	}
 }
 
+// Map keys for batch lookups
+void CICalendarSync::GetMapKeys(const CICalendarSyncDataList& data, cdstrvect& mapkeys)
+{
+	mapkeys.reserve(mapkeys.size() + data.size());
+	for(CICalendarSyncDataList::const_iterator iter = data.begin(); iter != data.end(); iter++)
+		mapkeys.push_back((*iter).GetMapKey());
+}
+
 void CICalendarSync::RemoveKeys(CICalendarSyncDataList& keys, const CICalendarComponentRecordDB& recorded, unsigned long filter)
 {
 	// Find recorded keys matching filter
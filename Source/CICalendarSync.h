@@ -100,6 +100,7 @@ protected:
 
 	void GetAllKeys(const CICalendar& cal, CICalendarSyncDataList& keys);
 	void GetKeys(const CICalendarComponentDB& db, CICalendarSyncDataList& keys);
+	void GetMapKeys(const CICalendarSyncDataList& data, cdstrvect& mapkeys);
 
 	void RemoveKeys(CICalendarSyncDataList& keys, const CICalendarComponentRecordDB& recorded, unsigned long filter);
 };
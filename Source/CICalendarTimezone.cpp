@@ -25,12 +25,71 @@
 
 #include "CICalendar.h"
 #include "CICalendarManager.h"
+#include "CICalendarMutex.h"
 #include "CICalendarUtils.h"
+#include "CICalendarVTimezone.h"
+
+#include <map>
 
 using namespace iCal;
 
+// Interned TZID with the timezone it last resolved to
+struct STZIDEntry
+{
+	cdstring				mTZID;
+	CICalendarVTimezone*	mResolved;
+	uint32_t				mGeneration;
+
+	STZIDEntry()
+		: mResolved(NULL), mGeneration(0) {}
+};
+
+// Entries are in chunks that never move so that readers can index them without a lock. New
+// entries are added under the mutex and published by the count.
+static const uint32_t cTZIDChunkSize = 256;
+static const uint32_t cTZIDMaxChunks = 4096;		// Packed date-times only hold 20-bit handles
+
+struct STZIDEntries
+{
+	STZIDEntry*	mChunks[cTZIDMaxChunks];
+	uint32_t	mCount;
+};
+
+typedef std::map<cdstring, uint32_t> CTZIDHandles;
+
+// Function statics so that these are available during static initialisation
+static STZIDEntries& GetTZIDEntries()
+{
+	// Entry 0 is the empty TZID
+	static STZIDEntries sEntries = { { new STZIDEntry[cTZIDChunkSize] }, 1 };
+	return sEntries;
+}
+
+static CTZIDHandles& GetTZIDHandles()
+{
+	static CTZIDHandles sHandles;
+	return sHandles;
+}
+
+static CICalendarMutex& GetTZIDMutex()
+{
+	static CICalendarMutex sMutex;
+	return sMutex;
+}
+
+static STZIDEntry* get_tzid_entry(uint32_t handle)
+{
+	STZIDEntries& entries = GetTZIDEntries();
+	if (handle >= CICalendarMutex::LoadAcquire(entries.mCount))
+		return NULL;
+	return &entries.mChunks[handle / cTZIDChunkSize][handle % cTZIDChunkSize];
+}
+
 CICalendarTimezone::CICalendarTimezone()
 {
+	mUTC = false;
+	mTimezone = 0;
+
 	// Copy defauilt timezone if it exists
 	if (CICalendarManager::sICalendarManager != NULL)
 	{
@@ -42,7 +101,7 @@ CICalendarTimezone::CICalendarTimezone()
 int CICalendarTimezone::operator==(const CICalendarTimezone& comp) const
 {
 	// Always match if any one of them is 'floating'
-	if (!mUTC && mTimezone.empty() || !comp.mUTC && comp.mTimezone.empty())
+	if (Floating() || comp.Floating())
 		return 1;
 	else if (mUTC ^ comp.mUTC)
 		return 0;
@@ -54,20 +113,93 @@ int32_t CICalendarTimezone::TimeZoneSecondsOffset(const CICalendarDateTime& dt)
 {
 	if (mUTC)
 		return 0;
-	else if (mTimezone.empty())
-		return CICalendar::getSICalendar().GetTimezoneOffsetSeconds(CICalendarManager::sICalendarManager->GetDefaultTimezone().GetTimezoneID(), dt);
 
-	// Look up timezone and resolve date using default timezones
-	return CICalendar::getSICalendar().GetTimezoneOffsetSeconds(mTimezone, dt);
+	// Go direct to the timezone if it is loaded
+	uint32_t handle = GetLookupHandle();
+	CICalendarVTimezone* tz = ResolveTZIDHandle(handle);
+	if (tz != NULL)
+		return tz->GetTimezoneOffsetSeconds(dt);
+
+	// Not loaded so resolve date using the default timezones table
+	return CICalendar::getSICalendar().GetTableTimezoneOffsetSeconds(GetTZID(handle), dt);
 }
 
 cdstring CICalendarTimezone::TimeZoneDescriptor(const CICalendarDateTime& dt) const
 {
 	if (mUTC)
 		return "(UTC)";
-	else if (mTimezone.empty())
-		return CICalendar::getSICalendar().GetTimezoneDescriptor(CICalendarManager::sICalendarManager->GetDefaultTimezone().GetTimezoneID(), dt);
 
-	// Look up timezone and resolve date using default timezones
-	return CICalendar::getSICalendar().GetTimezoneDescriptor(mTimezone, dt);
+	// Go direct to the timezone if it is loaded
+	uint32_t handle = GetLookupHandle();
+	CICalendarVTimezone* tz = ResolveTZIDHandle(handle);
+	if (tz != NULL)
+		return tz->GetTimezoneDescriptor(dt);
+
+	// Not loaded so resolve date using the default timezones table
+	return CICalendar::getSICalendar().GetTableTimezoneDescriptor(GetTZID(handle), dt);
+}
+
+// Floating uses the default timezone
+uint32_t CICalendarTimezone::GetLookupHandle() const
+{
+	if ((mTimezone == 0) && (CICalendarManager::sICalendarManager != NULL))
+		return CICalendarManager::sICalendarManager->GetDefaultTimezone().mTimezone;
+	else
+		return mTimezone;
+}
+
+uint32_t CICalendarTimezone::GetTZIDHandle(const cdstring& tzid)
+{
+	if (tzid.empty())
+		return 0;
+
+	CICalendarMutex::StLock lock(GetTZIDMutex());
+	CTZIDHandles& handles = GetTZIDHandles();
+	CTZIDHandles::const_iterator found = handles.find(tzid);
+	if (found != handles.end())
+		return (*found).second;
+
+	// Table is full - treat as floating
+	STZIDEntries& entries = GetTZIDEntries();
+	uint32_t handle = entries.mCount;
+	if (handle >= cTZIDChunkSize * cTZIDMaxChunks)
+		return 0;
+
+	// Add new entry
+	if (entries.mChunks[handle / cTZIDChunkSize] == NULL)
+		entries.mChunks[handle / cTZIDChunkSize] = new STZIDEntry[cTZIDChunkSize];
+	entries.mChunks[handle / cTZIDChunkSize][handle % cTZIDChunkSize].mTZID = tzid;
+	handles.insert(CTZIDHandles::value_type(tzid, handle));
+	CICalendarMutex::StoreRelease(entries.mCount, handle + 1);
+
+	return handle;
+}
+
+const cdstring& CICalendarTimezone::GetTZID(uint32_t handle)
+{
+	STZIDEntry* entry = get_tzid_entry(handle);
+	return (entry != NULL) ? entry->mTZID : cdstring::null_str;
+}
+
+// Get the full timezone in the static calendar (not ones only in a precompiled table)
+CICalendarVTimezone* CICalendarTimezone::ResolveTZIDHandle(uint32_t handle)
+{
+	STZIDEntry* entry = (handle != 0) ? get_tzid_entry(handle) : NULL;
+	if (entry == NULL)
+		return NULL;
+
+	// Look it up again only if timezones have been added or removed since last time
+	uint32_t generation = CICalendarVTimezone::GetGeneration();
+	if (CICalendarMutex::LoadAcquire(entry->mGeneration) != generation)
+	{
+		CICalendarVTimezone* resolved = const_cast<CICalendarVTimezone*>(CICalendar::getSICalendar().FindTimezone(entry->mTZID));
+
+		// Concurrent lookups all find the same one
+		CICalendarMutex::StLock lock(GetTZIDMutex());
+		entry->mResolved = resolved;
+		CICalendarMutex::StoreRelease(entry->mGeneration, generation);
+		return resolved;
+	}
+
+	return entry->mResolved;
 }
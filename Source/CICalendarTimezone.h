@@ -26,18 +26,21 @@
 
 #include "cdstring.h"
 
+#include <stdint.h>
+
 namespace iCal {
 
 class CICalendarDateTime;
+class CICalendarVTimezone;
 
 class CICalendarTimezone
 {
 public:
 	CICalendarTimezone();
 	CICalendarTimezone(bool utc)
-		{ mUTC = utc; }
+		{ mUTC = utc; mTimezone = 0; }
 	CICalendarTimezone(bool utc, const cdstring& tzid)
-		{ mUTC = utc; mTimezone = tzid; }
+		{ mUTC = utc; mTimezone = GetTZIDHandle(tzid); }
 	CICalendarTimezone(const CICalendarTimezone& copy)
 		{ _copy_CICalendarTimezone(copy); }
 	virtual ~CICalendarTimezone() {}
@@ -53,26 +56,37 @@ public:
 		{ mUTC = utc; }
 
 	const cdstring& GetTimezoneID() const
-		{ return mTimezone; }
+		{ return GetTZID(mTimezone); }
 	void SetTimezoneID(const cdstring& tzid)
-		{ mTimezone = tzid; }
+		{ mTimezone = GetTZIDHandle(tzid); }
+	uint32_t GetTimezoneHandle() const
+		{ return mTimezone; }
+	void SetTimezoneHandle(uint32_t handle)
+		{ mTimezone = handle; }
 
 	bool Floating() const
 	{
-		return !mUTC && mTimezone.empty();
+		return !mUTC && (mTimezone == 0);
 	}
 
 	bool HasTZID() const
 	{
-		return !mUTC && !mTimezone.empty();
+		return !mUTC && (mTimezone != 0);
 	}
 
 	int32_t		TimeZoneSecondsOffset(const CICalendarDateTime& dt) const;
 	cdstring	TimeZoneDescriptor(const CICalendarDateTime& dt) const;
 
+	// Interned TZIDs - handle 0 is the empty TZID
+	static uint32_t			GetTZIDHandle(const cdstring& tzid);
+	static const cdstring&	GetTZID(uint32_t handle);
+	static CICalendarVTimezone* ResolveTZIDHandle(uint32_t handle);
+
 protected:
 	bool			mUTC;
-	cdstring		mTimezone;
+	uint32_t		mTimezone;
+
+	uint32_t		GetLookupHandle() const;
 
 private:
 	void _copy_CICalendarTimezone(const CICalendarTimezone& copy)
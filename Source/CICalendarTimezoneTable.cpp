@@ -0,0 +1,285 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+	CICalendarTimezoneTable.cpp
+
+	Author:
+	Description:	precompiled binary table of timezone transitions
+*/
+
+#include "CICalendarTimezoneTable.h"
+
+#include "CICalendar.h"
+#include "CICalendarDateTime.h"
+#include "CICalendarDefinitions.h"
+#include "CICalendarVTimezone.h"
+#include "CICalendarVTimezoneElement.h"
+
+#include <algorithm>
+#include <cstring>
+#include <strstream>
+#include <vector>
+
+using namespace iCal;
+
+const char CICalendarTimezoneTable::cMagic[4] = { 'I', 'C', 'T', 'Z' };
+
+static bool sort_by_tzid(const CICalendarVTimezone* tz1, const CICalendarVTimezone* tz2)
+{
+	return ::strcmp(tz1->GetID().c_str(), tz2->GetID().c_str()) < 0;
+}
+
+static uint32_t add_string(std::vector<char>& strings, const char* str, size_t length)
+{
+	uint32_t result = strings.size();
+	strings.insert(strings.end(), str, str + length);
+	strings.push_back(0);
+	return result;
+}
+
+// Write the transitions for all timezones in the calendar over the range of years
+bool CICalendarTimezoneTable::Compile(const CICalendar& cal, int32_t start_year, int32_t end_year, std::ostream& os)
+{
+	if (start_year >= end_year)
+		return false;
+
+	// Sort timezones by TZID for binary search
+	std::vector<const CICalendarVTimezone*> tzs;
+	for(CICalendarComponentDB::const_iterator iter = cal.GetVTimezone().begin(); iter != cal.GetVTimezone().end(); iter++)
+		tzs.push_back(static_cast<const CICalendarVTimezone*>((*iter).second));
+	std::sort(tzs.begin(), tzs.end(), sort_by_tzid);
+
+	std::vector<SZone> zones;
+	std::vector<STransition> transitions;
+	std::vector<char> strings;
+	for(std::vector<const CICalendarVTimezone*>::const_iterator iter = tzs.begin(); iter != tzs.end(); iter++)
+	{
+		const CICalendarVTimezone* tz = *iter;
+
+		SZone zone;
+		zone.mID = add_string(strings, tz->GetID().c_str(), tz->GetID().length());
+		zone.mSortKey = tz->GetSortKey();
+
+		// Keep the original definition so the full component can be created on demand
+		std::ostrstream sout;
+		sout << cICalComponent_BEGINVCALENDAR << net_endl;
+		sout << cICalProperty_VERSION << ":2.0" << net_endl;
+		tz->Generate(sout);
+		sout << cICalComponent_ENDVCALENDAR << net_endl << std::ends;
+		cdstring definition;
+		definition.steal(sout.str());
+		zone.mDefinition = add_string(strings, definition.c_str(), definition.length());
+		zone.mDefinitionLength = definition.length();
+
+		CICalendarVTimezone::STransitionList items;
+		tz->ExpandTransitions(start_year, end_year, items);
+		zone.mFirstTransition = transitions.size();
+		zone.mTransitionCount = items.size();
+		for(CICalendarVTimezone::STransitionList::const_iterator iter2 = items.begin(); iter2 != items.end(); iter2++)
+		{
+			STransition transition;
+			transition.mOnset = (*iter2).mOnset;
+			transition.mOffset = (*iter2).mElement->GetUTCOffset();
+			transition.mName = add_string(strings, (*iter2).mElement->GetTZName().c_str(), (*iter2).mElement->GetTZName().length());
+			transitions.push_back(transition);
+		}
+
+		zones.push_back(zone);
+	}
+
+	SHeader header;
+	::memcpy(header.mMagic, cMagic, sizeof(cMagic));
+	header.mVersion = cVersion;
+	header.mStartYear = start_year;
+	header.mEndYear = end_year;
+	header.mRangeStart = CICalendarDateTime(start_year, 1, 1, 0, 0, 0).GetFloatingPosixTime();
+	header.mRangeEnd = CICalendarDateTime(end_year, 1, 1, 0, 0, 0).GetFloatingPosixTime();
+	header.mZoneCount = zones.size();
+	header.mTransitionCount = transitions.size();
+	header.mStringsLength = strings.size();
+	header.mPad = 0;
+
+	os.write(reinterpret_cast<const char*>(&header), sizeof(SHeader));
+	if (!zones.empty())
+		os.write(reinterpret_cast<const char*>(&zones[0]), zones.size() * sizeof(SZone));
+	if (!transitions.empty())
+		os.write(reinterpret_cast<const char*>(&transitions[0]), transitions.size() * sizeof(STransition));
+	if (!strings.empty())
+		os.write(&strings[0], strings.size());
+
+	return !os.fail();
+}
+
+bool CICalendarTimezoneTable::Load(const char* data, size_t length)
+{
+	Clear();
+
+	// Validate header
+	if ((data == NULL) || (length < sizeof(SHeader)))
+		return false;
+	const SHeader* header = reinterpret_cast<const SHeader*>(data);
+	if ((::memcmp(header->mMagic, cMagic, sizeof(cMagic)) != 0) || (header->mVersion != cVersion))
+		return false;
+
+	// Validate size
+	uint64_t needed = sizeof(SHeader) +
+						static_cast<uint64_t>(header->mZoneCount) * sizeof(SZone) +
+						static_cast<uint64_t>(header->mTransitionCount) * sizeof(STransition) +
+						header->mStringsLength;
+	if (needed > length)
+		return false;
+
+	const SZone* zones = reinterpret_cast<const SZone*>(data + sizeof(SHeader));
+	const STransition* transitions = reinterpret_cast<const STransition*>(zones + header->mZoneCount);
+	const char* strings = reinterpret_cast<const char*>(transitions + header->mTransitionCount);
+
+	// Validate all offsets so that lookups need no checks
+	if ((header->mStringsLength != 0) && (strings[header->mStringsLength - 1] != 0))
+		return false;
+	for(uint32_t i = 0; i < header->mZoneCount; i++)
+	{
+		const SZone& zone = zones[i];
+		if ((zone.mID >= header->mStringsLength) ||
+			(zone.mDefinition >= header->mStringsLength) ||
+			(zone.mDefinitionLength >= header->mStringsLength - zone.mDefinition) ||
+			(zone.mFirstTransition > header->mTransitionCount) ||
+			(zone.mTransitionCount > header->mTransitionCount - zone.mFirstTransition))
+			return false;
+	}
+	for(uint32_t i = 0; i < header->mTransitionCount; i++)
+	{
+		if (transitions[i].mName >= header->mStringsLength)
+			return false;
+	}
+
+	mHeader = header;
+	mZones = zones;
+	mTransitions = transitions;
+	mStrings = strings;
+
+	return true;
+}
+
+int32_t CICalendarTimezoneTable::GetStartYear() const
+{
+	return (mHeader != NULL) ? mHeader->mStartYear : 0;
+}
+
+int32_t CICalendarTimezoneTable::GetEndYear() const
+{
+	return (mHeader != NULL) ? mHeader->mEndYear : 0;
+}
+
+void CICalendarTimezoneTable::GetTimezones(cdstrvect& tzids) const
+{
+	if (mHeader == NULL)
+		return;
+
+	for(uint32_t i = 0; i < mHeader->mZoneCount; i++)
+		tzids.push_back(mStrings + mZones[i].mID);
+}
+
+int32_t CICalendarTimezoneTable::GetSortKey(const cdstring& tzid) const
+{
+	const SZone* zone = FindZone(tzid);
+	return (zone != NULL) ? zone->mSortKey : 0;
+}
+
+bool CICalendarTimezoneTable::GetTimezoneOffsetSeconds(const cdstring& tzid, const CICalendarDateTime& dt, int32_t& offset) const
+{
+	const STransition* found = NULL;
+	if (!FindTransition(tzid, dt, found))
+		return false;
+
+	offset = (found != NULL) ? found->mOffset : 0;
+	return true;
+}
+
+bool CICalendarTimezoneTable::GetTimezoneDescriptor(const cdstring& tzid, const CICalendarDateTime& dt, cdstring& desc) const
+{
+	const STransition* found = NULL;
+	if (!FindTransition(tzid, dt, found))
+		return false;
+
+	if (found != NULL)
+		desc = CICalendarVTimezone::FormatDescriptor(found->mOffset, mStrings + found->mName);
+	else
+		desc = cdstring::null_str;
+	return true;
+}
+
+bool CICalendarTimezoneTable::GetTimezoneDefinition(const cdstring& tzid, const char*& data, size_t& length) const
+{
+	const SZone* zone = FindZone(tzid);
+	if (zone == NULL)
+		return false;
+
+	data = mStrings + zone->mDefinition;
+	length = zone->mDefinitionLength;
+	return true;
+}
+
+const CICalendarTimezoneTable::SZone* CICalendarTimezoneTable::FindZone(const cdstring& tzid) const
+{
+	if (mHeader == NULL)
+		return NULL;
+
+	// Binary search on TZID
+	uint32_t lo = 0;
+	uint32_t hi = mHeader->mZoneCount;
+	while(lo < hi)
+	{
+		uint32_t mid = (lo + hi) / 2;
+		int result = ::strcmp(mStrings + mZones[mid].mID, tzid.c_str());
+		if (result == 0)
+			return &mZones[mid];
+		else if (result < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return NULL;
+}
+
+// Find the last transition strictly before the date-time. Returns false if outside the table.
+bool CICalendarTimezoneTable::FindTransition(const cdstring& tzid, const CICalendarDateTime& dt, const STransition*& found) const
+{
+	const SZone* zone = FindZone(tzid);
+	if (zone == NULL)
+		return false;
+
+	int64_t onset = dt.GetFloatingPosixTime();
+	if ((onset < mHeader->mRangeStart) || (onset >= mHeader->mRangeEnd))
+		return false;
+
+	// Binary search on onset
+	const STransition* first = mTransitions + zone->mFirstTransition;
+	uint32_t lo = 0;
+	uint32_t hi = zone->mTransitionCount;
+	while(lo < hi)
+	{
+		uint32_t mid = (lo + hi) / 2;
+		if (first[mid].mOnset < onset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	found = (lo != 0) ? &first[lo - 1] : NULL;
+	return true;
+}
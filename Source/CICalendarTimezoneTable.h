@@ -0,0 +1,131 @@
+/*
+    Copyright (c) 2007 Cyrus Daboo. All rights reserved.
+    
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+    
+        http://www.apache.org/licenses/LICENSE-2.0
+    
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+	CICalendarTimezoneTable.h
+
+	Author:
+	Description:	precompiled binary table of timezone transitions
+*/
+
+#ifndef CICalendarTimezoneTable_H
+#define CICalendarTimezoneTable_H
+
+#include <iostream>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "cdstring.h"
+
+namespace iCal {
+
+class CICalendar;
+class CICalendarDateTime;
+
+// Binary layout (native byte order):
+//
+//   SHeader
+//   SZone[mZoneCount]				- sorted by TZID
+//   STransition[mTransitionCount]	- grouped by zone, each group sorted by onset
+//   char[mStringsLength]			- nul-terminated TZIDs, TZNAMEs and VCALENDAR text of each zone
+//
+// Onsets are wall-clock posix times, the same way CICalendarVTimezone looks up offsets.
+
+class CICalendarTimezoneTable
+{
+public:
+	CICalendarTimezoneTable()
+		{ _init_CICalendarTimezoneTable(); }
+	~CICalendarTimezoneTable() {}
+
+	static bool Compile(const CICalendar& cal, int32_t start_year, int32_t end_year, std::ostream& os);
+
+	// Data must remain valid until Clear() or destruction
+	bool Load(const char* data, size_t length);
+	void Clear()
+		{ _init_CICalendarTimezoneTable(); }
+	bool IsLoaded() const
+		{ return mHeader != NULL; }
+
+	int32_t GetStartYear() const;
+	int32_t GetEndYear() const;
+
+	bool HasTimezone(const cdstring& tzid) const
+		{ return FindZone(tzid) != NULL; }
+	void GetTimezones(cdstrvect& tzids) const;
+	int32_t GetSortKey(const cdstring& tzid) const;
+
+	// These return false if the timezone or date is not covered by the table
+	bool GetTimezoneOffsetSeconds(const cdstring& tzid, const CICalendarDateTime& dt, int32_t& offset) const;
+	bool GetTimezoneDescriptor(const cdstring& tzid, const CICalendarDateTime& dt, cdstring& desc) const;
+
+	// VCALENDAR text containing the original VTIMEZONE
+	bool GetTimezoneDefinition(const cdstring& tzid, const char*& data, size_t& length) const;
+
+private:
+	struct SHeader
+	{
+		char		mMagic[4];
+		uint32_t	mVersion;
+		int32_t		mStartYear;
+		int32_t		mEndYear;
+		int64_t		mRangeStart;
+		int64_t		mRangeEnd;
+		uint32_t	mZoneCount;
+		uint32_t	mTransitionCount;
+		uint32_t	mStringsLength;
+		uint32_t	mPad;
+	};
+
+	struct SZone
+	{
+		uint32_t	mID;
+		uint32_t	mDefinition;
+		uint32_t	mDefinitionLength;
+		int32_t		mSortKey;
+		uint32_t	mFirstTransition;
+		uint32_t	mTransitionCount;
+	};
+
+	struct STransition
+	{
+		int64_t		mOnset;
+		int32_t		mOffset;
+		uint32_t	mName;
+	};
+
+	static const char		cMagic[4];
+	static const uint32_t	cVersion = 1;
+
+	const SHeader*		mHeader;
+	const SZone*		mZones;
+	const STransition*	mTransitions;
+	const char*			mStrings;
+
+	const SZone*		FindZone(const cdstring& tzid) const;
+	bool				FindTransition(const cdstring& tzid, const CICalendarDateTime& dt, const STransition*& found) const;
+
+	void	_init_CICalendarTimezoneTable()
+		{ mHeader = NULL; mZones = NULL; mTransitions = NULL; mStrings = NULL; }
+
+	// Not copyable - points into external data
+	CICalendarTimezoneTable(const CICalendarTimezoneTable& copy);
+	CICalendarTimezoneTable& operator=(const CICalendarTimezoneTable& copy);
+};
+
+}	// namespace iCal
+
+#endif	// CICalendarTimezoneTable_H
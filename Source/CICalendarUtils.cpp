@@ -25,6 +25,7 @@
 
 #include "CICalendarDateTime.h"
 
+#include <cstring>
 #include <strstream>
 
 using namespace iCal;
@@ -62,6 +63,55 @@ bool CICalendarUtils::ReadFoldedLine(std::istream& is, cdstring& line1, cdstring
 	return true;
 }
 
+// Unfold the next line from a buffer, advancing start past it
+// Behaves the same as the stream version: blank lines end folding and are skipped
+bool CICalendarUtils::ReadFoldedLine(const char*& start, const char* end, cdstring& line)
+{
+	if (start >= end)
+		return false;
+
+	// Fill first line
+	const char* eol = FindLineEnd(start, end);
+	line.assign(start, TrimLineEnd(start, eol) - start);
+	start = (eol < end) ? eol + 1 : end;
+
+	// Now loop looking ahead at the next line to see if it is folded
+	while(start < end)
+	{
+		eol = FindLineEnd(start, end);
+		const char* content_end = TrimLineEnd(start, eol);
+
+		// Does it start with a space => folded
+		if ((content_end != start) && isspace(*start))
+		{
+			// Copy folded line (without space) to current line and cycle for more
+			line.append(start + 1, content_end - start - 1);
+			start = (eol < end) ? eol + 1 : end;
+		}
+		else
+		{
+			// Blank line is consumed, anything else is left for the next call
+			if (content_end == start)
+				start = (eol < end) ? eol + 1 : end;
+			break;
+		}
+	}
+
+	return true;
+}
+
+const char* CICalendarUtils::FindLineEnd(const char* start, const char* end)
+{
+	const char* eol = static_cast<const char*>(::memchr(start, '\n', end - start));
+	return (eol != NULL) ? eol : end;
+}
+
+const char* CICalendarUtils::TrimLineEnd(const char* start, const char* eol)
+{
+	// Allow for CRLF line endings
+	return ((eol != start) && (*(eol - 1) == '\r')) ? eol - 1 : eol;
+}
+
 // Write out iCal encoded text value
 void CICalendarUtils::WriteTextValue(std::ostream& os, const cdstring& value)
 {
@@ -174,6 +224,58 @@ cdstring CICalendarUtils::DecodeTextValue(const cdstring& value)
 
 }
 
+// Parse a number from at most width characters, the same way strtol would
+int32_t CICalendarUtils::ParseFixedNumber(const char* p, size_t width)
+{
+	const char* end = p + width;
+
+	// Skip leading space and sign
+	while((p < end) && (*p != 0) && isspace(*p))
+		p++;
+	bool negative = false;
+	if ((p < end) && ((*p == '-') || (*p == '+')))
+		negative = (*p++ == '-');
+
+	int32_t result = 0;
+	while((p < end) && (*p >= '0') && (*p <= '9'))
+		result = result * 10 + (*p++ - '0');
+
+	return negative ? -result : result;
+}
+
+// Parse an unsigned number and advance past it, the same way strtoul would
+// Returns false if the number is too large
+bool CICalendarUtils::ParseNumber(const char*& p, uint32_t& num)
+{
+	const char* q = p;
+
+	// Skip leading space and sign
+	while((*q != 0) && isspace(*q))
+		q++;
+	bool negative = false;
+	if ((*q == '-') || (*q == '+'))
+		negative = (*q++ == '-');
+
+	// No digits leaves the pointer where it was
+	if ((*q < '0') || (*q > '9'))
+	{
+		num = 0;
+		return true;
+	}
+
+	uint64_t result = 0;
+	while((*q >= '0') && (*q <= '9'))
+	{
+		result = result * 10 + (*q++ - '0');
+		if (result > 0xFFFFFFFFUL)
+			return false;
+	}
+
+	num = negative ? -static_cast<uint32_t>(result) : static_cast<uint32_t>(result);
+	p = q;
+	return true;
+}
+
 int32_t CICalendarUtils::DaysInMonth(const int32_t month, const int32_t year)
 {
 	// NB month is 1..12 so use dummy value at start of array to avoid index adjustment
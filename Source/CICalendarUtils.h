@@ -40,10 +40,15 @@ public:
 	typedef std::vector<std::vector<int32_t> > CICalendarTable;
 
 	static bool	ReadFoldedLine(std::istream& is, cdstring& line1, cdstring& line2);
+	static bool	ReadFoldedLine(const char*& start, const char* end, cdstring& line);
 
 	static void WriteTextValue(std::ostream& os, const cdstring& value);
 	static cdstring DecodeTextValue(const cdstring& value);
 
+	// Number parsing direct from the source text
+	static int32_t	ParseFixedNumber(const char* p, size_t width);
+	static bool		ParseNumber(const char*& p, uint32_t& num);
+
 	// Date/time calcs
 	static int32_t	DaysInMonth(const int32_t month, const int32_t year);
 	static int32_t	DaysUptoMonth(const int32_t month, const int32_t year);
@@ -72,6 +77,8 @@ private:
 	CICalendarUtils() {}
 	~CICalendarUtils() {}
 
+	static const char*	FindLineEnd(const char* start, const char* end);
+	static const char*	TrimLineEnd(const char* start, const char* eol);
 };
 
 }	// namespace iCal
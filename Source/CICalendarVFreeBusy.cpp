@@ -26,6 +26,7 @@
 #include "CICalendarDefinitions.h"
 #include "CICalendarDuration.h"
 #include "CICalendarMultiValue.h"
+#include "CICalendarMutex.h"
 #include "CICalendarPeriodValue.h"
 
 #include <algorithm>
@@ -36,6 +37,13 @@ using namespace iCal;
 cdstring CICalendarVFreeBusy::sBeginDelimiter(cICalComponent_BEGINVFREEBUSY);
 cdstring CICalendarVFreeBusy::sEndDelimiter(cICalComponent_ENDVFREEBUSY);
 
+// Function static so that this is available during static initialisation
+static CICalendarMutex& GetBusyTimeMutex()
+{
+	static CICalendarMutex sMutex;
+	return sMutex;
+}
+
 void CICalendarVFreeBusy::_init_CICalendarVFreeBusy()
 {
 	mHasStart = false;
@@ -197,8 +205,7 @@ void CICalendarVFreeBusy::EditTiming(const CICalendarDateTime& start, const CICa
 void CICalendarVFreeBusy::ExpandPeriod(const CICalendarPeriod& period, CICalendarComponentList& list)
 {
 	// Cache the busy-time details if not done already
-	if (!mCachedBusyTime)
-		CacheBusyTime();
+	CacheBusyTime();
 	
 	// See if period intersects the busy time span range
 	if ((mBusyTime != NULL) && period.IsPeriodOverlap(mSpanPeriod))
@@ -210,8 +217,7 @@ void CICalendarVFreeBusy::ExpandPeriod(const CICalendarPeriod& period, CICalenda
 void CICalendarVFreeBusy::ExpandPeriod(const CICalendarPeriod& period, CICalendarFreeBusyList& list)
 {
 	// Cache the busy-time details if not done already
-	if (!mCachedBusyTime)
-		CacheBusyTime();
+	CacheBusyTime();
 	
 	// See if period intersects the busy time span range
 	if ((mBusyTime != NULL) && period.IsPeriodOverlap(mSpanPeriod))
@@ -223,8 +229,7 @@ void CICalendarVFreeBusy::ExpandPeriod(const CICalendarPeriod& period, CICalenda
 void CICalendarVFreeBusy::GetPeriod(CICalendarFreeBusyList& list)
 {
 	// Cache the busy-time details if not done already
-	if (!mCachedBusyTime)
-		CacheBusyTime();
+	CacheBusyTime();
 	
 	// See if period intersects the busy time span range
 	if (mBusyTime != NULL)
@@ -235,10 +240,15 @@ void CICalendarVFreeBusy::GetPeriod(CICalendarFreeBusyList& list)
 
 void CICalendarVFreeBusy::CacheBusyTime()
 {
-	// Clear out any existing cache
-	if (mBusyTime != NULL)
-		delete mBusyTime;
-	mBusyTime = new CICalendarFreeBusyList();
+	// Concurrent readers may get here at the same time
+	if (CICalendarMutex::LoadAcquire(mCachedBusyTime))
+		return;
+	CICalendarMutex::StLock lock(GetBusyTimeMutex());
+	if (mCachedBusyTime)
+		return;
+
+	// Only made visible once complete
+	CICalendarFreeBusyList* busy = new CICalendarFreeBusyList();
 
 	// Get all FREEBUSY items and add those that are BUSY
 	CICalendarDateTime	min_start;
@@ -250,9 +260,9 @@ void CICalendarVFreeBusy::CacheBusyTime()
 		// Check the properties FBTYPE attribute
 		CICalendarFreeBusy::EBusyType type;
 		bool is_busy = false;
-		if ((*iter).second.HasAttribute(iCal::cICalAttribute_FBTYPE))
+		if ((*iter).second.HasAttribute(iCal::CICalendarAttribute::eFBTYPE))
 		{
-			const cdstring& fbyype = (*iter).second.GetAttributeValue(iCal::cICalAttribute_FBTYPE);
+			const cdstring& fbyype = (*iter).second.GetAttributeValue(iCal::CICalendarAttribute::eFBTYPE);
 			if ((fbyype.compare(iCal::cICalAttribute_FBTYPE_BUSY, true) == 0))
 			{
 				is_busy = true;
@@ -293,9 +303,9 @@ void CICalendarVFreeBusy::CacheBusyTime()
 					CICalendarPeriodValue* period = dynamic_cast<CICalendarPeriodValue*>(*iter2);
 					if (period != NULL)
 					{
-						mBusyTime->push_back(CICalendarFreeBusy(type, period->GetValue()));
+						busy->push_back(CICalendarFreeBusy(type, period->GetValue()));
 						
-						if (mBusyTime->size() == 1)
+						if (busy->size() == 1)
 						{
 							min_start = period->GetValue().GetStart();
 							max_end = period->GetValue().GetEnd();
@@ -314,16 +324,16 @@ void CICalendarVFreeBusy::CacheBusyTime()
 	}
 
 	// If nothing present, empty the list
-	if (mBusyTime->size() == 0)
+	if (busy->size() == 0)
 	{
-		delete mBusyTime;
-		mBusyTime = NULL;
+		delete busy;
+		busy = NULL;
 	}
 	else
 	{
 	
 		// Sort the list by period
-		std::sort(mBusyTime->begin(), mBusyTime->end());
+		std::sort(busy->begin(), busy->end());
 
 		// Determine range
 		CICalendarDateTime	start;
@@ -340,5 +350,8 @@ void CICalendarVFreeBusy::CacheBusyTime()
 		mSpanPeriod = CICalendarPeriod(start, end);
 	}
 	
-	mCachedBusyTime = true;
+	// Clear out any existing cache
+	delete mBusyTime;
+	mBusyTime = busy;
+	CICalendarMutex::StoreRelease(mCachedBusyTime, true);
 }
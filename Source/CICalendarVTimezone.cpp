@@ -31,11 +31,15 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <iterator>
 
 using namespace iCal;
 
 cdstring CICalendarVTimezone::sBeginDelimiter(cICalComponent_BEGINVTIMEZONE);
 cdstring CICalendarVTimezone::sEndDelimiter(cICalComponent_ENDVTIMEZONE);
+#ifndef __VCPP__
+uint32_t CICalendarVTimezone::sGeneration = 1;
+#endif
 
 CICalendarVTimezone::~CICalendarVTimezone()
 {
@@ -45,6 +49,11 @@ void CICalendarVTimezone::_copy_CICalendarVTimezone(const CICalendarVTimezone& c
 {
 	mID = copy.mID;
 	mSortKey = copy.mSortKey;
+
+	// Cached transitions refer to the other object's elements
+	mTransitions.clear();
+	mTransitionsStart = 0;
+	mTransitionsEnd = 0;
 }
 
 bool CICalendarVTimezone::AddComponent(CICalendarComponent* comp)
@@ -56,12 +65,31 @@ bool CICalendarVTimezone::AddComponent(CICalendarComponent* comp)
 			mEmbedded = new CICalendarComponentList;
 		mEmbedded->push_back(comp);
 		mEmbedded->back()->SetEmbedder(this);
+		ChangedTransitions();
 		return true;
 	}
 	else
 		return false;
 }
 
+void CICalendarVTimezone::Added()
+{
+	// Invalidate any cached lookups
+	CICalendarMutex::Increment(sGeneration);
+
+	// Do inherited
+	CICalendarComponent::Added();
+}
+
+void CICalendarVTimezone::Removed()
+{
+	// Invalidate any cached lookups
+	CICalendarMutex::Increment(sGeneration);
+
+	// Do inherited
+	CICalendarComponent::Removed();
+}
+
 void CICalendarVTimezone::Finalise()
 {
 	// Get TZID
@@ -70,6 +98,7 @@ void CICalendarVTimezone::Finalise()
 	// Sort sub-components by DTSTART
 	if (mEmbedded != NULL)
 		sort(mEmbedded->begin(), mEmbedded->end(), CICalendarVTimezoneElement::sort_dtstart);
+	ChangedTransitions();
 
 	// Do inherited
 	CICalendarComponent::Finalise();
@@ -77,6 +106,7 @@ void CICalendarVTimezone::Finalise()
 
 int32_t CICalendarVTimezone::GetSortKey() const
 {
+	CICalendarMutex::StLock lock(mCacheMutex);
 	if (mSortKey == 1)
 	{
 		// Take time from first element
@@ -119,32 +149,37 @@ int32_t CICalendarVTimezone::GetTimezoneOffsetSeconds(const CICalendarDateTime&
 
 cdstring CICalendarVTimezone::GetTimezoneDescriptor(const CICalendarDateTime& dt)
 {
-	cdstring result;
-
 	// Get the closet matching element to the time
 	const CICalendarVTimezoneElement* found = FindTimezoneElement(dt);
 
 	// Get it
 	if (found != NULL)
+		return FormatDescriptor(found->GetUTCOffset(), found->GetTZName());
+	else
+		return cdstring::null_str;
+}
+
+cdstring CICalendarVTimezone::FormatDescriptor(int32_t offset, const cdstring& tzname)
+{
+	cdstring result;
+
+	if (tzname.empty())
 	{
-		if (found->GetTZName().empty())
-		{
-			result.reserve(32);
-			int32_t tzoffset = found->GetUTCOffset();
-			bool negative = false;
-			if (tzoffset < 0)
-			{
-				tzoffset = -tzoffset;
-				negative = true;
-			}
-			::snprintf(result, 32, "%s%02ld%02ld", negative ? "-" : "+", tzoffset / (60 * 60), (tzoffset / 60) % 60);
-		}
-		else
+		result.reserve(32);
+		int32_t tzoffset = offset;
+		bool negative = false;
+		if (tzoffset < 0)
 		{
-			result = "(";
-			result += found->GetTZName();
-			result += ")";
+			tzoffset = -tzoffset;
+			negative = true;
 		}
+		::snprintf(result, 32, "%s%02ld%02ld", negative ? "-" : "+", tzoffset / (60 * 60), (tzoffset / 60) % 60);
+	}
+	else
+	{
+		result = "(";
+		result += tzname;
+		result += ")";
 	}
 	
 	return result;
@@ -152,73 +187,121 @@ cdstring CICalendarVTimezone::GetTimezoneDescriptor(const CICalendarDateTime& dt
 
 const CICalendarVTimezoneElement* CICalendarVTimezone::FindTimezoneElement(const CICalendarDateTime& dt)
 {
-	// Need to make the incoming date-time relative to the DTSTART in the timezone component for proper comparison.
-	// This means making the incoming date-time a floating (no timezone) item
-	CICalendarDateTime temp(dt);
-	temp.GetTimezone().SetTimezoneID("");
+	CICalendarMutex::StLock lock(mCacheMutex);
+
+	// Make sure the cached transitions cover the requested date-time
+	if ((dt.GetYear() < mTransitionsStart) || (dt.GetYear() >= mTransitionsEnd))
+		CacheTransitions(dt.GetYear());
+
+	// Look for the last transition before the date-time, compared as a floating (wall-clock) value
+	STransitionList::const_iterator found = std::lower_bound(mTransitions.begin(), mTransitions.end(), STransition(dt.GetFloatingPosixTime(), NULL));
+	if (found != mTransitions.begin())
+		return (*(found - 1)).mElement;
+	else
+		return NULL;
+}
+
+// Extend the cached transitions to cover the decade the year is in
+void CICalendarVTimezone::CacheTransitions(int32_t year)
+{
+	int32_t start = (year / 10) * 10;
+	int32_t end = start + 10;
+	if (mTransitionsStart < mTransitionsEnd)
+	{
+		start = std::min(start, mTransitionsStart);
+		end = std::max(end, mTransitionsEnd);
+	}
 
-	// New scheme to avoid unneccessary timezone recurrence expansion:
+	ExpandTransitions(start, end, mTransitions);
+	mTransitionsStart = start;
+	mTransitionsEnd = end;
+}
 
-	// Look for the standard and daylight components with a start time just below the requested date-time
-	const CICalendarVTimezoneElement* found_std = NULL;
-	const CICalendarVTimezoneElement* found_day = NULL;
+// Must be called whenever the elements change
+void CICalendarVTimezone::ChangedTransitions()
+{
+	mTransitions.clear();
+	mTransitionsStart = 0;
+	mTransitionsEnd = 0;
+	mSortKey = 1;
 
+	// Element rules may have been edited directly so clear their caches too
 	if (mEmbedded != NULL)
 	{
 		for(CICalendarComponentList::const_iterator iter = mEmbedded->begin(); iter != mEmbedded->end(); iter++)
-		{
-			const CICalendarVTimezoneElement* item = static_cast<const CICalendarVTimezoneElement*>(*iter);
-			if (item->GetStart() < temp)
-			{
-				if (item->GetType() == eVTIMEZONESTANDARD)
-					found_std = item;
-				else
-					found_day = item;
-			}
-		}		
+			static_cast<CICalendarVTimezoneElement*>(*iter)->GetRecurrenceSet()->Changed();
 	}
-	
-	// Now do the expansion for each one found and pick the lowest
-	const CICalendarVTimezoneElement* found = NULL;
-	CICalendarDateTime dt_found;
+}
+
+// Get every offset change in the range of years, sorted by onset.
+// The last change before the start of the range is included so that the first year is covered.
+// Follows the same rules as FindTimezoneElement: an element of each type applies until the next
+// element of the same type starts, and standard wins over daylight when both start together.
+void CICalendarVTimezone::ExpandTransitions(int32_t start_year, int32_t end_year, STransitionList& transitions) const
+{
+	transitions.clear();
+	if (mEmbedded == NULL)
+		return;
+
+	// Element start times are floating so the range must be too
+	CICalendarTimezone floating(false);
+	CICalendarDateTime start(start_year, 1, 1, 0, 0, 0, &floating);
+	CICalendarDateTime end(end_year, 1, 1, 0, 0, 0, &floating);
+	int64_t range_start = start.GetFloatingPosixTime();
+	int64_t range_end = end.GetFloatingPosixTime();
 
-	if (found_std)
+	// Separate lists for each type so that each can be truncated at the next element of the same type
+	STransitionList std_items;
+	STransitionList day_items;
+	for(CICalendarComponentList::const_iterator iter = mEmbedded->begin(); iter != mEmbedded->end(); iter++)
 	{
-		CICalendarDateTime dt_item = found_std->ExpandBelow(temp);
-		if (temp >= dt_item)
+		const CICalendarVTimezoneElement* item = static_cast<const CICalendarVTimezoneElement*>(*iter);
+		STransitionList& items = (item->GetType() == eVTIMEZONESTANDARD) ? std_items : day_items;
+
+		// Previous element of this type stops when this one starts
+		int64_t item_start = item->GetStart().GetFloatingPosixTime();
+		while(!items.empty() && (items.back().mOnset >= item_start))
+			items.pop_back();
+
+		if (item_start >= range_end)
+			continue;
+
+		if (item->GetRecurrenceSet()->HasRecurrence())
 		{
-			found = found_std;
-			dt_found = dt_item;
+			CICalendarDateTimeList onsets;
+			CICalendarPeriod period(item->GetStart(), end);
+			item->GetRecurrenceSet()->Expand(item->GetStart(), period, onsets);
+			for(CICalendarDateTimeList::const_iterator iter2 = onsets.begin(); iter2 != onsets.end(); iter2++)
+				items.push_back(STransition((*iter2).GetFloatingPosixTime(), item));
 		}
+		else
+			items.push_back(STransition(item_start, item));
 	}
-	
-	if (found_day)
+
+	// Merge with standard ahead of daylight for the same onset
+	transitions.reserve(std_items.size() + day_items.size());
+	std::merge(std_items.begin(), std_items.end(), day_items.begin(), day_items.end(), std::back_inserter(transitions));
+
+	STransitionList::iterator last = transitions.begin();
+	for(STransitionList::iterator iter = transitions.begin(); iter != transitions.end(); iter++)
 	{
-		CICalendarDateTime dt_item = found_day->ExpandBelow(temp);
-		if (temp >= dt_item)
-		{
-			if (found != NULL)
-			{
-				// Compare with the one previously cached and switch to this one if newer
-				if (dt_item > dt_found)
-				{
-					found = found_day;
-					dt_found = dt_item;
-				}
-			}
-			else
-			{
-				found = found_day;
-				dt_found = dt_item;
-			}
-		}
+		// Skip duplicate onsets
+		if ((iter != transitions.begin()) && ((*iter).mOnset == (*(last - 1)).mOnset))
+			continue;
+		
+		// Only keep the last one before the start of the range
+		if (((*iter).mOnset < range_start) && (last != transitions.begin()))
+			last--;
+
+		*last++ = *iter;
 	}
-	
-	return found;
+	transitions.erase(last, transitions.end());
 }
 
 void CICalendarVTimezone::MergeTimezone(const CICalendarVTimezone& tz)
 {
+	// Any merged elements invalidate the cached transitions
+	ChangedTransitions();
 }
 
 bool CICalendarVTimezone::ValidEDST() const
@@ -285,6 +368,7 @@ void CICalendarVTimezone::UpgradeEDST()
 			if ((offset_std - offset_day == -1*60*60) && (offset_std >= -8*60*60) && (offset_std <= -4*60*60))
 			{
 				AddEDST(offset_std);
+				ChangedTransitions();
 				return;
 			}
 		}
@@ -305,6 +389,7 @@ void CICalendarVTimezone::UpgradeEDST()
 			if ((offset_std - offset_day == -1*60*60) && (offset_std >= -8*60*60) && (offset_std <= -4*60*60))
 			{
 				AddEDST(offset_std);
+				ChangedTransitions();
 				return;
 			}
 		}
@@ -25,6 +25,9 @@
 #define CICalendarVTimezone_H
 
 #include "CICalendarComponent.h"
+#include "CICalendarMutex.h"
+
+#include <vector>
 
 namespace iCal {
 
@@ -34,6 +37,26 @@ class CICalendarVTimezoneElement;
 class CICalendarVTimezone: public CICalendarComponent
 {
 public:
+	// A change of offset - onset is the wall-clock posix time at which the element takes effect
+	struct STransition
+	{
+		int64_t								mOnset;
+		const CICalendarVTimezoneElement*	mElement;
+
+		STransition(int64_t onset, const CICalendarVTimezoneElement* element)
+			: mOnset(onset), mElement(element) {}
+
+		bool operator<(const STransition& comp) const
+			{ return mOnset < comp.mOnset; }
+	};
+	typedef std::vector<STransition> STransitionList;
+
+	static cdstring FormatDescriptor(int32_t offset, const cdstring& tzname);
+
+	// Changes whenever a timezone is added or removed
+	static uint32_t GetGeneration()
+		{ return CICalendarMutex::LoadAcquire(sGeneration); }
+
 	static CICalendarComponent* Create(const CICalendarRef& calendar)
 		{ return new CICalendarVTimezone(calendar); }
 	static const cdstring& GetVBegin()
@@ -43,7 +66,7 @@ public:
 
 	CICalendarVTimezone(const CICalendarRef& calendar) :
 		CICalendarComponent(calendar)
-		{ mSortKey = 1; }
+		{ mSortKey = 1; mTransitionsStart = 0; mTransitionsEnd = 0; }
 	CICalendarVTimezone(const CICalendarVTimezone& copy) :
 		CICalendarComponent(copy)
 		{ _copy_CICalendarVTimezone(copy); }
@@ -79,6 +102,9 @@ public:
 
 	virtual bool AddComponent(CICalendarComponent* comp);
 
+	virtual void Added();
+	virtual void Removed();
+
 	virtual const cdstring& GetMapKey() const
 		{ return mID; }
 
@@ -91,6 +117,9 @@ public:
 
 	int32_t GetTimezoneOffsetSeconds(const CICalendarDateTime& dt);
 	cdstring GetTimezoneDescriptor(const CICalendarDateTime& dt);
+
+	void	ExpandTransitions(int32_t start_year, int32_t end_year, STransitionList& transitions) const;
+	void	ChangedTransitions();
 	
 	void	MergeTimezone(const CICalendarVTimezone& tz);
 
@@ -100,11 +129,19 @@ public:
 protected:
 	static cdstring		sBeginDelimiter;
 	static cdstring		sEndDelimiter;
+	static uint32_t		sGeneration;
 
 	cdstring				mID;
+	mutable CICalendarMutex	mCacheMutex;		// Sort key and transitions are filled in by concurrent readers
 	mutable int32_t			mSortKey;
 
+	// Cached transitions for years in [mTransitionsStart, mTransitionsEnd)
+	STransitionList			mTransitions;
+	int32_t					mTransitionsStart;
+	int32_t					mTransitionsEnd;
+
 	const CICalendarVTimezoneElement*	FindTimezoneElement(const CICalendarDateTime& dt);
+	void	CacheTransitions(int32_t year);
 
 	void	AddEDST(int32_t offset_std);
 
@@ -29,6 +29,12 @@
 
 using namespace iCal;
 
+// Compare packed items against a date-time in a different timezone
+static bool less_than_dt(const CICalendarPackedDateTime& item, const CICalendarDateTime& dt)
+{
+	return item.GetDateTime() < dt;
+}
+
 bool CICalendarVTimezoneElement::sort_dtstart(const CICalendarComponent* s1, const CICalendarComponent* s2)
 {
 	const CICalendarVTimezoneElement* e1 = static_cast<const CICalendarVTimezoneElement*>(s1);
@@ -61,6 +67,8 @@ void CICalendarVTimezoneElement::Finalise()
 // Find the newest expanded date-time for this element that is older than the requested one
 CICalendarDateTime CICalendarVTimezoneElement::ExpandBelow(const CICalendarDateTime& below) const
 {
+	CICalendarMutex::StLock lock(mCacheMutex);
+
 	// Look for recurrences
 	if (!mRecurrences.HasRecurrence() || (mStart > below))
 		// Return DTSTART even if it is newer
@@ -83,18 +91,34 @@ CICalendarDateTime CICalendarVTimezoneElement::ExpandBelow(const CICalendarDateT
 		// Use cache of expansion		
 		if (temp > mCachedExpandBelow)
 		{
-			mCachedExpandBelowItems.clear();
+			CICalendarDateTimeList items;
 			CICalendarPeriod period(mStart, temp);
-			mRecurrences.Expand(mStart, period, mCachedExpandBelowItems);
+			mRecurrences.Expand(mStart, period, items);
+			mCachedExpandBelowItems.clear();
+			mCachedExpandBelowItems.reserve(items.size());
+			mCachedExpandBelowSameZone = true;
+			for(CICalendarDateTimeList::const_iterator iter = items.begin(); iter != items.end(); iter++)
+			{
+				mCachedExpandBelowItems.push_back(CICalendarPackedDateTime(*iter));
+
+				// RDATEs may be in a different timezone to DTSTART
+				if (((*iter).GetTimezone().GetUTC() != mStart.GetTimezone().GetUTC()) ||
+					((*iter).GetTimezone().GetTimezoneHandle() != mStart.GetTimezone().GetTimezoneHandle()))
+					mCachedExpandBelowSameZone = false;
+			}
 			mCachedExpandBelow = temp;
 		}
 		
 		if (mCachedExpandBelowItems.size() != 0)
 		{
 			// List comes back sorted so we pick the element just less than the dt value we want
-			CICalendarDateTimeList::const_iterator found = std::lower_bound(mCachedExpandBelowItems.begin(), mCachedExpandBelowItems.end(), below);
+			CICalendarPackedDateTimeList::const_iterator found;
+			if (mCachedExpandBelowSameZone && (below.GetTimezone() == mStart.GetTimezone()))
+				found = std::lower_bound(mCachedExpandBelowItems.begin(), mCachedExpandBelowItems.end(), CICalendarPackedDateTime(below));
+			else
+				found = std::lower_bound(mCachedExpandBelowItems.begin(), mCachedExpandBelowItems.end(), below, less_than_dt);
 			if (found != mCachedExpandBelowItems.begin())
-				return *(found - 1);
+				return (*(found - 1)).GetDateTime();
 		}
 
 		return mStart;
@@ -27,6 +27,7 @@
 #include "CICalendarVTimezone.h"
 
 #include "CICalendarDateTime.h"
+#include "CICalendarPackedDateTime.h"
 #include "CICalendarRecurrenceSet.h"
 
 namespace iCal {
@@ -38,10 +39,10 @@ public:
 
 	CICalendarVTimezoneElement(const CICalendarRef& calendar) :
 		CICalendarVTimezone(calendar)
-		{ mUTCOffset = 0; }
+		{ mUTCOffset = 0; mCachedExpandBelowSameZone = true; }
 	CICalendarVTimezoneElement(const CICalendarRef& calendar, const CICalendarDateTime& dt, int32_t offset = 0) :
 		CICalendarVTimezone(calendar)
-		{ mStart = dt; mUTCOffset = offset; mCachedExpandBelow = mStart; }
+		{ mStart = dt; mUTCOffset = offset; mCachedExpandBelow = mStart; mCachedExpandBelowSameZone = true; }
 	CICalendarVTimezoneElement(const CICalendarVTimezoneElement& copy) :
 		CICalendarVTimezone(copy)
 		{ _copy_CICalendarVTimezoneElement(copy); }
@@ -85,11 +86,12 @@ protected:
 	cdstring				mTZName;
 	CICalendarRecurrenceSet	mRecurrences;
 	mutable CICalendarDateTime		mCachedExpandBelow;
-	mutable CICalendarDateTimeList	mCachedExpandBelowItems;
+	mutable CICalendarPackedDateTimeList	mCachedExpandBelowItems;
+	mutable bool					mCachedExpandBelowSameZone;
 
 private:
 	void	_copy_CICalendarVTimezoneElement(const CICalendarVTimezoneElement& copy)
-		{ mStart = copy.mStart; mUTCOffset = copy.mUTCOffset; mTZName = copy.mTZName; mRecurrences = copy.mRecurrences; mCachedExpandBelow = mStart; }
+		{ mStart = copy.mStart; mUTCOffset = copy.mUTCOffset; mTZName = copy.mTZName; mRecurrences = copy.mRecurrences; mCachedExpandBelow = mStart; mCachedExpandBelowItems.clear(); mCachedExpandBelowSameZone = true; }
 };
 
 }	// namespace iCal
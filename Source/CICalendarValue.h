@@ -24,6 +24,8 @@
 #ifndef CICalendarValue_H
 #define CICalendarValue_H
 
+#include "CICalendarArena.h"
+
 #include <iostream>
 #include <vector>
 
@@ -61,6 +63,12 @@ public:
 	CICalendarValue() {}
 	virtual ~CICalendarValue() {}
 
+	// Allocate from the current arena if there is one
+	static void* operator new(size_t size)
+		{ return CICalendarArena::Allocate(size); }
+	static void operator delete(void* p)
+		{ CICalendarArena::Deallocate(p); }
+
 	virtual CICalendarValue* clone() = 0;
 
 	virtual EICalValueType GetType() const = 0;
@@ -802,9 +802,8 @@ void CITIPProcessor::ClearITIPRequest(CICalendarComponent& comp)
 			if (itip.compare(cICalAttribute_RSVP_TRUE, true) == 0)
 			{
 				// Remove the attribute
-				CICalendarAttribute& attr_mod = const_cast<CICalendarAttribute&>((*prop.GetAttributes().find(cICalAttribute_ATTENDEE_X_NEEDS_ITIP)).second);
-				attr_mod.GetValues().clear();
-				attr_mod.AddValue(cICalAttribute_RSVP_FALSE);
+				CICalendarAttribute& attr_mod = const_cast<CICalendarAttribute&>(*prop.GetAttributes().find(cICalAttribute_ATTENDEE_X_NEEDS_ITIP));
+				attr_mod.SetValue(cICalAttribute_RSVP_FALSE);
 			}
 		}
 	}